@@ -0,0 +1,1537 @@
+#ifndef BUCKET_HASH_MAP_HPP_
+#define BUCKET_HASH_MAP_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <initializer_list>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "ics_exceptions.hpp"
+#include "pair.hpp"
+#include "nodepool.hpp"
+#include "hashing.hpp"
+
+
+namespace ics {
+
+
+#ifndef undefinedhashdefined
+#define undefinedhashdefined
+template<class T>
+hash_t<T> undefinedhash (const T& a) {return 0;}
+#endif /* undefinedhashdefined */
+
+
+//BucketHashMap/BucketHashSet chain their bins like HashMap/HashSet, but each link of a chain is a
+//  cache-line (64-byte) aligned block holding several entries inline, plus a one-byte tag (bits of
+//  the entry's hash value) per slot. A bin's first block is in the bin array itself; a bin overflows
+//  into a linked block only when its blocks are full. A lookup compares the tags of a block (one
+//  cache line for small entries) and compares keys only on a tag match, so a chain of k entries costs
+//  about k/slots cache misses instead of k, while entries never move when others are put or erased.
+//
+//References/pointers to entries (and iterators) stay valid across puts and erases of other keys; a
+//  rehash (growing when used > load_threshold * bins * slots) moves every entry, as in a vector.
+//  Constructing with enough initial_bins (each holding slots entries) avoids rehashing.
+//Erasing leaves a hole that a later put into the same bin reuses; an overflow block is freed as
+//  soon as it holds no entries.
+//
+//Instantiate the templated class supplying thash(a): produces a hash value for a.
+//If thash is defaulted to undefinedhash in the template, then a constructor must supply chash.
+//If both thash and chash are supplied, then they must be the same (by ==) function.
+//If neither is supplied, or both are supplied but different, TemplateFunctionError is raised.
+//The (unique) non-undefinedhash value supplied by thash/chash is stored in the instance variable hash.
+
+
+//The tag stored for an entry whose hash value is hashed: never 0, which marks an empty slot.
+//  It comes from the high bits of hash_mix(hashed), which hash_bin (using the low bits) ignores.
+inline unsigned char bucket_tag(int hashed) {
+    return static_cast<unsigned char>((hash_mix(hashed) >> 24) | 0x80);
+}
+
+
+//# bytes of a block with n slots of E: next pointer, n tags, then n entries (aligned for E)
+template<class E>
+constexpr std::size_t bucket_block_bytes(int n) {
+    return (sizeof(void*) + n + alignof(E) - 1) / alignof(E) * alignof(E) + n * sizeof(E);
+}
+
+
+//# slots in a block of E: as many as fit in 64 bytes (but at least 1, for large entries)
+template<class E>
+constexpr int bucket_block_slots() {
+    int n = 1;
+    while (n < 16 and bucket_block_bytes<E>(n + 1) <= 64){
+        n++;
+    }
+    return n;
+}
+
+
+template<class E>
+class alignas(64) BucketBlock {
+  public:
+    static constexpr int slots = bucket_block_slots<E>();
+
+    BucketBlock<E>* next = nullptr;    //Overflow block (from the owner's pool), or nullptr
+    unsigned char   tag[slots] = {};   //0 for an empty slot; else bucket_tag of its entry's hash value
+
+    E& entry (int i) {return *std::launder(reinterpret_cast<E*>(storage[i]));}
+
+    bool empty () const {
+        for (int i = 0; i < slots; i++){
+            if (tag[i] != 0){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<class... Args>
+    E& make (int i, unsigned char the_tag, Args&&... args) {
+        ::new (static_cast<void*>(storage[i])) E(std::forward<Args>(args)...);
+        tag[i] = the_tag;
+        return entry(i);
+    }
+
+    void destroy (int i) {
+        entry(i).~E();
+        tag[i] = 0;
+    }
+
+  private:
+    alignas(E) unsigned char storage[slots][sizeof(E)];
+};
+
+
+//A position in a bucket table: slot slot of block (in bin bin's chain); block == nullptr means none
+template<class E>
+class BucketCursor {
+  public:
+    BucketCursor (std::size_t the_bin = 0, BucketBlock<E>* the_block = nullptr, int the_slot = 0)
+    : bin(the_bin), block(the_block), slot(the_slot) {}
+
+    std::size_t     bin;
+    BucketBlock<E>* block;
+    int             slot;
+};
+
+
+//Moves c to the next occupied slot of the bins bins in table (or to none: c.block == nullptr);
+//  from_start moves it to the first occupied slot instead
+template<class E>
+void bucket_advance(BucketBlock<E>* table, std::size_t bins, BucketCursor<E>& c, bool from_start) {
+    std::size_t     bin   = (from_start ? 0 : c.bin);
+    BucketBlock<E>* block = (from_start ? &table[0] : c.block);
+    int             slot  = (from_start ? 0 : c.slot + 1);
+    while (bin < bins){
+        for (; block != nullptr; block = block->next, slot = 0){
+            for (; slot < BucketBlock<E>::slots; slot++){
+                if (block->tag[slot] != 0){
+                    c = BucketCursor<E>(bin, block, slot);
+                    return;
+                }
+            }
+        }
+        if (++bin < bins){
+            block = &table[bin];
+            slot  = 0;
+        }
+    }
+    c = BucketCursor<E>();
+}
+
+
+
+
+template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class BucketHashMap {
+  public:
+    typedef ics::pair<KEY,T>   Entry;
+    typedef int (*hashfunc) (const KEY& a);
+
+    //Destructor/Constructors
+    ~BucketHashMap ();
+
+    BucketHashMap          (double the_load_threshold = 0.75, int (*chash)(const KEY& a) = nullptr);
+    explicit BucketHashMap (int initial_bins, double the_load_threshold = 0.75, int (*chash)(const KEY& k) = nullptr);
+    BucketHashMap          (const BucketHashMap<KEY,T,thash>& to_copy, double the_load_threshold = 0.75, int (*chash)(const KEY& a) = nullptr);
+    explicit BucketHashMap (const std::initializer_list<Entry>& il, double the_load_threshold = 0.75, int (*chash)(const KEY& a) = nullptr);
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    explicit BucketHashMap (const Iterable& i, double the_load_threshold = 0.75, int (*chash)(const KEY& a) = nullptr);
+
+
+    //Queries
+    bool empty      () const;
+    std::size_t size () const;
+    bool has_key    (const KEY& key) const;
+    bool has_value  (const T& value) const;
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+
+    //Commands
+    T    put   (const KEY& key, const T& value);
+    T    erase (const KEY& key);
+    void clear ();
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    std::size_t put_all(const Iterable& i);
+
+
+    //Operators
+
+    T&       operator [] (const KEY&);
+    const T& operator [] (const KEY&) const;
+    BucketHashMap<KEY,T,thash>& operator = (const BucketHashMap<KEY,T,thash>& rhs);
+    bool operator == (const BucketHashMap<KEY,T,thash>& rhs) const;
+    bool operator != (const BucketHashMap<KEY,T,thash>& rhs) const;
+
+    template<class KEY2,class T2, int (*hash2)(const KEY2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const BucketHashMap<KEY2,T2,hash2>& m);
+
+
+
+  private:
+    typedef BucketBlock<Entry>  Block;
+    typedef BucketCursor<Entry> Cursor;
+
+  public:
+    class Iterator {
+      public:
+        //Private constructor called in begin/end, which are friends of BucketHashMap<T>
+        ~Iterator();
+        Entry       erase();
+        std::string str  () const;
+        BucketHashMap<KEY,T,thash>::Iterator& operator ++ ();
+        BucketHashMap<KEY,T,thash>::Iterator  operator ++ (int);
+        bool operator == (const BucketHashMap<KEY,T,thash>::Iterator& rhs) const;
+        bool operator != (const BucketHashMap<KEY,T,thash>::Iterator& rhs) const;
+        Entry& operator *  () const;
+        Entry* operator -> () const;
+        friend std::ostream& operator << (std::ostream& outs, const BucketHashMap<KEY,T,thash>::Iterator& i) {
+          outs << i.str(); //Use the same meaning as the debugging .str() method
+          return outs;
+        }
+        friend Iterator BucketHashMap<KEY,T,thash>::begin () const;
+        friend Iterator BucketHashMap<KEY,T,thash>::end   () const;
+
+      private:
+        //If can_erase is false, current indexes the entry after the one erased (or none)
+        Cursor                      current; //current.block == nullptr when exhausted
+        BucketHashMap<KEY,T,thash>* ref_map;
+        int                         expected_mod_count;
+        bool                        can_erase = true;
+
+        //Called in friends begin/end
+        Iterator(BucketHashMap<KEY,T,thash>* iterate_over, bool from_begin);
+    };
+
+
+    Iterator begin () const;
+    Iterator end   () const;
+
+
+  private:
+  HashFunction<KEY,thash> hash; //Hashing function used (from template or constructor)
+  Block* map    = nullptr;    //Array of bins blocks: each bin's first block; its overflow blocks come from pool
+  double load_threshold;      //used/(bins*Block::slots) <= load_threshold
+  std::size_t bins = 1;       //# bins in array: a power of two
+  std::size_t used = 0;       //Cache for number of key->value pairs in the hash table
+  int mod_count = 0;          //For sensing concurrent modification
+
+  mutable NodePool<Block> pool; //Allocates every overflow block
+
+
+  //Helper methods
+  std::size_t bins_for       (std::size_t count)       const;  //# bins that count entries need at load_threshold
+  Cursor find_key            (const KEY& key)          const;  //Returns key's position (block == nullptr if absent)
+  template <class... Args>
+  Entry& place               (Block* ht, std::size_t bins, int hashed, Args&&... args);  //Construct an entry in a free slot of its bin in ht
+  void   erase_at            (const Cursor& c);                //Destroy c's entry; free its block if it is an empty overflow block
+  void   copy_entries        (const BucketHashMap<KEY,T,thash>& from);  //Place from's entries into this (empty) map
+
+  void   ensure_load_threshold(std::size_t new_used);          //Grow if used/(bins*slots) would exceed load_threshold
+  void   rehash               (std::size_t new_bins);          //Move every entry into new_bins bins
+  void   delete_hash_table    (Block*& ht, std::size_t bins);  //Destroy all entries in ht, free its overflow blocks, then ht (ht == nullptr)
+};
+
+
+
+
+template<class T, int (*thash)(const T& a) = undefinedhash<T>> class BucketHashSet {
+  public:
+    typedef int (*hashfunc) (const T& a);
+
+    //Destructor/Constructors
+    ~BucketHashSet ();
+
+    BucketHashSet          (double the_load_threshold = 0.75, int (*chash)(const T& a) = nullptr);
+    explicit BucketHashSet (int initial_bins, double the_load_threshold = 0.75, int (*chash)(const T& k) = nullptr);
+    BucketHashSet          (const BucketHashSet<T,thash>& to_copy, double the_load_threshold = 0.75, int (*chash)(const T& a) = nullptr);
+    explicit BucketHashSet (const std::initializer_list<T>& il, double the_load_threshold = 0.75, int (*chash)(const T& a) = nullptr);
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    explicit BucketHashSet (const Iterable& i, double the_load_threshold = 0.75, int (*chash)(const T& a) = nullptr);
+
+
+    //Queries
+    bool empty      () const;
+    std::size_t size () const;
+    bool contains   (const T& element) const;
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    bool contains_all (const Iterable& i) const;
+
+
+    //Commands
+    int  insert (const T& element);
+    int  erase  (const T& element);
+    void clear  ();
+
+    //Iterable class must support "for" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    std::size_t insert_all(const Iterable& i);
+
+    template <class Iterable>
+    std::size_t erase_all(const Iterable& i);
+
+
+    //Operators
+    BucketHashSet<T,thash>& operator = (const BucketHashSet<T,thash>& rhs);
+    bool operator == (const BucketHashSet<T,thash>& rhs) const;
+    bool operator != (const BucketHashSet<T,thash>& rhs) const;
+    bool operator <= (const BucketHashSet<T,thash>& rhs) const;
+    bool operator <  (const BucketHashSet<T,thash>& rhs) const;
+    bool operator >= (const BucketHashSet<T,thash>& rhs) const;
+    bool operator >  (const BucketHashSet<T,thash>& rhs) const;
+
+    template<class T2, int (*hash2)(const T2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const BucketHashSet<T2,hash2>& s);
+
+
+
+  private:
+    typedef BucketBlock<T>  Block;
+    typedef BucketCursor<T> Cursor;
+
+  public:
+    class Iterator {
+      public:
+        //Private constructor called in begin/end, which are friends of BucketHashSet<T>
+        ~Iterator();
+        T           erase();
+        std::string str  () const;
+        BucketHashSet<T,thash>::Iterator& operator ++ ();
+        BucketHashSet<T,thash>::Iterator  operator ++ (int);
+        bool operator == (const BucketHashSet<T,thash>::Iterator& rhs) const;
+        bool operator != (const BucketHashSet<T,thash>::Iterator& rhs) const;
+        T& operator *  () const;
+        T* operator -> () const;
+        friend std::ostream& operator << (std::ostream& outs, const BucketHashSet<T,thash>::Iterator& i) {
+          outs << i.str(); //Use the same meaning as the debugging .str() method
+          return outs;
+        }
+        friend Iterator BucketHashSet<T,thash>::begin () const;
+        friend Iterator BucketHashSet<T,thash>::end   () const;
+
+      private:
+        //If can_erase is false, current indexes the element after the one erased (or none)
+        Cursor                  current; //current.block == nullptr when exhausted
+        BucketHashSet<T,thash>* ref_set;
+        int                     expected_mod_count;
+        bool                    can_erase = true;
+
+        //Called in friends begin/end
+        Iterator(BucketHashSet<T,thash>* iterate_over, bool from_begin);
+    };
+
+
+    Iterator begin () const;
+    Iterator end   () const;
+
+
+  private:
+  HashFunction<T,thash> hash; //Hashing function used (from template or constructor)
+  Block* set    = nullptr;    //Array of bins blocks: each bin's first block; its overflow blocks come from pool
+  double load_threshold;      //used/(bins*Block::slots) <= load_threshold
+  std::size_t bins = 1;       //# bins in array: a power of two
+  std::size_t used = 0;       //Cache for number of elements in the hash table
+  int mod_count = 0;          //For sensing concurrent modification
+
+  mutable NodePool<Block> pool; //Allocates every overflow block
+
+
+  //Helper methods
+  std::size_t bins_for       (std::size_t count)       const;  //# bins that count elements need at load_threshold
+  Cursor find_element        (const T& element)        const;  //Returns element's position (block == nullptr if absent)
+  template <class... Args>
+  T&     place               (Block* ht, std::size_t bins, int hashed, Args&&... args);  //Construct an element in a free slot of its bin in ht
+  void   erase_at            (const Cursor& c);                //Destroy c's element; free its block if it is an empty overflow block
+  void   copy_elements       (const BucketHashSet<T,thash>& from);  //Place from's elements into this (empty) set
+
+  void   ensure_load_threshold(std::size_t new_used);          //Grow if used/(bins*slots) would exceed load_threshold
+  void   rehash               (std::size_t new_bins);          //Move every element into new_bins bins
+  void   delete_hash_table    (Block*& ht, std::size_t bins);  //Destroy all elements in ht, free its overflow blocks, then ht (ht == nullptr)
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//BucketHashMap class and related definitions
+
+//Destructor/Constructors
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>::~BucketHashMap() {
+    delete_hash_table(map, bins);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>::BucketHashMap(double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashMap::default constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashMap::default constructor: both specified and different");
+    }
+    map = new Block[bins];
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>::BucketHashMap(int initial_bins, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashMap::length constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashMap::length constructor: both specified and different");
+    }
+    bins = bin_count<true>(std::size_t(std::max(1, initial_bins)));
+    map  = new Block[bins];
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>::BucketHashMap(const BucketHashMap<KEY,T,thash>& to_copy, double the_load_threshold, int (*chash)(const KEY& a))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        hash = to_copy.hash;
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashMap::copy constructor: both specified and different");
+    }
+    bins = bins_for(to_copy.used);
+    map  = new Block[bins];
+    copy_entries(to_copy);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>::BucketHashMap(const std::initializer_list<Entry>& il, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashMap::initializer_list constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashMap::initializer_list constructor: both specified and different");
+    }
+    bins = bins_for(il.size());
+    map  = new Block[bins];
+    for (const Entry& m_entry : il){
+        put(m_entry.first, m_entry.second);
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template <class Iterable>
+BucketHashMap<KEY,T,thash>::BucketHashMap(const Iterable& i, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashMap::Iterable constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashMap::Iterable constructor: both specified and different");
+    }
+    bins = bins_for(i.size());
+    map  = new Block[bins];
+    for (const Entry& m_entry : i){
+        put(m_entry.first, m_entry.second);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Queries
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool BucketHashMap<KEY,T,thash>::empty() const {
+    return used == 0;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t BucketHashMap<KEY,T,thash>::size() const {
+    return used;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool BucketHashMap<KEY,T,thash>::has_key (const KEY& key) const {
+    return find_key(key).block != nullptr;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool BucketHashMap<KEY,T,thash>::has_value (const T& value) const {
+    for (const Entry& m_entry : *this){
+        if (value == m_entry.second){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string BucketHashMap<KEY,T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "BucketHashMap[";
+    for (std::size_t i = 0; i < bins; i++){
+        answer << std::endl << "  bin[" << i << "]:";
+        for (Block* b = &map[i]; b != nullptr; b = b->next){
+            answer << " |";
+            for (int s = 0; s < Block::slots; s++){
+                if (b->tag[s] != 0){
+                    answer << " " << b->entry(s).first << "->" << b->entry(s).second;
+                }
+                else{
+                    answer << " -";
+                }
+            }
+        }
+    }
+    answer << "](load_threshold=" << load_threshold << ",bins=" << bins << ",slots=" << Block::slots
+           << ",used=" << used << ",mod_count=" << mod_count << ")";
+    return answer.str();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Commands
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T BucketHashMap<KEY,T,thash>::put(const KEY& key, const T& value) {
+    mod_count++;
+    Cursor c = find_key(key);
+    if (c.block != nullptr){
+        T& stored = c.block->entry(c.slot).second;
+        T to_return = stored;
+        stored = value;
+        return to_return;
+    }
+
+    ensure_load_threshold(used + 1);
+    place(map, bins, hash(key), key, value);
+    used++;
+    return value;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T BucketHashMap<KEY,T,thash>::erase(const KEY& key) {
+    Cursor c = find_key(key);
+    if (c.block == nullptr){
+        std::ostringstream answer;
+        answer << "BucketHashMap::erase: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+
+    T to_return = c.block->entry(c.slot).second;
+    erase_at(c);
+    mod_count++;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void BucketHashMap<KEY,T,thash>::clear() {
+    delete_hash_table(map, bins);
+    map = new Block[bins];
+    mod_count++;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class Iterable>
+std::size_t BucketHashMap<KEY,T,thash>::put_all(const Iterable& i) {
+    std::size_t count = 0;
+    for (const Entry& m_entry : i){
+        count++;
+        put(m_entry.first, m_entry.second);
+    }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Operators
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T& BucketHashMap<KEY,T,thash>::operator [] (const KEY& key) {
+    Cursor c = find_key(key);
+    if (c.block != nullptr){
+        return c.block->entry(c.slot).second;
+    }
+
+    ensure_load_threshold(used + 1);
+    Entry& e = place(map, bins, hash(key), key, T());
+    used++;
+    mod_count++;
+    return e.second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+const T& BucketHashMap<KEY,T,thash>::operator [] (const KEY& key) const {
+    Cursor c = find_key(key);
+    if (c.block == nullptr){
+        std::ostringstream answer;
+        answer << "BucketHashMap::operator []: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return c.block->entry(c.slot).second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>& BucketHashMap<KEY,T,thash>::operator = (const BucketHashMap<KEY,T,thash>& rhs) {
+    if (this == &rhs){
+        return *this;
+    }
+    delete_hash_table(map, bins);
+    bins = bins_for(rhs.used);
+    map  = new Block[bins];
+    copy_entries(rhs);
+    mod_count++;
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool BucketHashMap<KEY,T,thash>::operator == (const BucketHashMap<KEY,T,thash>& rhs) const {
+    if (this == &rhs){
+        return true;
+    }
+    if (used != rhs.size()){
+        return false;
+    }
+
+    for (const Entry& m_entry : *this){
+        Cursor c = rhs.find_key(m_entry.first);
+        if (c.block == nullptr or m_entry.second != c.block->entry(c.slot).second){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool BucketHashMap<KEY,T,thash>::operator != (const BucketHashMap<KEY,T,thash>& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::ostream& operator << (std::ostream& outs, const BucketHashMap<KEY,T,thash>& m) {
+    outs << "map[";
+    bool first = true;
+    for (const auto& m_entry : m){
+        outs << (first ? "" : ",") << m_entry.first << "->" << m_entry.second;
+        first = false;
+    }
+    outs << "]";
+    return outs;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator constructors
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto BucketHashMap<KEY,T,thash>::begin () const -> BucketHashMap<KEY,T,thash>::Iterator {
+    return Iterator(const_cast<BucketHashMap<KEY,T,thash>*>(this), true);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto BucketHashMap<KEY,T,thash>::end () const -> BucketHashMap<KEY,T,thash>::Iterator {
+    return Iterator(const_cast<BucketHashMap<KEY,T,thash>*>(this), false);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Private helper methods
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t BucketHashMap<KEY,T,thash>::bins_for (std::size_t count) const {
+    return bin_count<true>(std::size_t(std::min(double(max_bins<std::size_t>()), double(count) / (load_threshold * Block::slots))));
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto BucketHashMap<KEY,T,thash>::find_key (const KEY& key) const -> Cursor {
+    int           hashed = hash(key);
+    std::size_t   bin    = hash_bin<true>(hashed, bins);
+    unsigned char tag    = bucket_tag(hashed);
+    for (Block* b = &map[bin]; b != nullptr; b = b->next){
+        for (int s = 0; s < Block::slots; s++){
+            if (b->tag[s] == tag and key == b->entry(s).first){
+                return Cursor(bin, b, s);
+            }
+        }
+    }
+    return Cursor(bin, nullptr, 0);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class... Args>
+auto BucketHashMap<KEY,T,thash>::place (Block* ht, std::size_t bins, int hashed, Args&&... args) -> Entry& {
+    Block* head = &ht[hash_bin<true>(hashed, bins)];
+    for (Block* b = head; b != nullptr; b = b->next){
+        for (int s = 0; s < Block::slots; s++){
+            if (b->tag[s] == 0){
+                return b->make(s, bucket_tag(hashed), std::forward<Args>(args)...);
+            }
+        }
+    }
+
+    //Every block is full: link a new one right after the first (which is in the array)
+    Block* b   = pool.make();
+    b->next    = head->next;
+    head->next = b;
+    return b->make(0, bucket_tag(hashed), std::forward<Args>(args)...);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void BucketHashMap<KEY,T,thash>::erase_at (const Cursor& c) {
+    c.block->destroy(c.slot);
+    used--;
+    Block* head = &map[c.bin];
+    if (c.block != head and c.block->empty()){
+        Block* prev = head;
+        while (prev->next != c.block){
+            prev = prev->next;
+        }
+        prev->next = c.block->next;
+        pool.recycle(c.block);
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void BucketHashMap<KEY,T,thash>::copy_entries (const BucketHashMap<KEY,T,thash>& from) {
+    for (const Entry& m_entry : from){
+        place(map, bins, hash(m_entry.first), m_entry);
+        used++;
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void BucketHashMap<KEY,T,thash>::ensure_load_threshold(std::size_t new_used) {
+    if (double(new_used) <= load_threshold * double(bins) * Block::slots or bins >= max_bins<std::size_t>()){
+        return;
+    }
+    rehash(bins * 2);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void BucketHashMap<KEY,T,thash>::rehash (std::size_t new_bins) {
+    Block*      old_map  = map;
+    std::size_t old_bins = bins;
+
+    map  = new Block[new_bins];
+    bins = new_bins;
+    for (std::size_t i = 0; i < old_bins; i++){
+        for (Block* b = &old_map[i]; b != nullptr; ){
+            for (int s = 0; s < Block::slots; s++){
+                if (b->tag[s] != 0){
+                    Entry& e = b->entry(s);
+                    place(map, bins, hash(e.first), std::move(e));
+                    b->destroy(s);
+                }
+            }
+            Block* to_recycle = b;
+            b = b->next;
+            if (to_recycle != &old_map[i]){
+                pool.recycle(to_recycle);
+            }
+        }
+    }
+    delete[] old_map;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void BucketHashMap<KEY,T,thash>::delete_hash_table (Block*& ht, std::size_t bins) {
+    for (std::size_t i = 0; i < bins; i++){
+        for (Block* b = &ht[i]; b != nullptr; ){
+            for (int s = 0; s < Block::slots; s++){
+                if (b->tag[s] != 0){
+                    b->destroy(s);
+                }
+            }
+            Block* to_recycle = b;
+            b = b->next;
+            if (to_recycle != &ht[i]){
+                pool.recycle(to_recycle);
+            }
+        }
+    }
+    delete[] ht;
+    ht   = nullptr;
+    used = 0;
+}
+
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator class definitions
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>::Iterator::Iterator(BucketHashMap<KEY,T,thash>* iterate_over, bool from_begin)
+        : ref_map(iterate_over), expected_mod_count(ref_map->mod_count) {
+    if (from_begin){
+        bucket_advance(ref_map->map, ref_map->bins, current, true);
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+BucketHashMap<KEY,T,thash>::Iterator::~Iterator()
+{}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto BucketHashMap<KEY,T,thash>::Iterator::erase() -> Entry {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("BucketHashMap::Iterator::erase");
+    }
+    if (!can_erase){
+        throw CannotEraseError("BucketHashMap::Iterator::erase Iterator cursor already erased");
+    }
+    if (current.block == nullptr){
+        throw CannotEraseError("BucketHashMap::Iterator::erase Iterator cursor beyond data structure");
+    }
+
+    //Position current at the following entry first (erase_at may free current's block, but only
+    //  when it holds no other entry), which ++ will not skip
+    can_erase = false;
+    Cursor to_erase = current;
+    Entry  to_return = to_erase.block->entry(to_erase.slot);
+    bucket_advance(ref_map->map, ref_map->bins, current, false);
+    ref_map->erase_at(to_erase);
+    ref_map->mod_count++;
+    expected_mod_count = ref_map->mod_count;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string BucketHashMap<KEY,T,thash>::Iterator::str() const {
+    std::ostringstream answer;
+    answer << ref_map->str() << "(current=" << current.bin << "/" << current.slot << ",expected_mod_count=" << expected_mod_count << ",can_erase=" << can_erase << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto BucketHashMap<KEY,T,thash>::Iterator::operator ++ () -> BucketHashMap<KEY,T,thash>::Iterator& {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("BucketHashMap::Iterator::operator ++");
+    }
+    if (current.block == nullptr){
+        return *this;
+    }
+    if (can_erase){
+        bucket_advance(ref_map->map, ref_map->bins, current, false);
+    }
+    can_erase = true;
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto BucketHashMap<KEY,T,thash>::Iterator::operator ++ (int) -> BucketHashMap<KEY,T,thash>::Iterator {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("BucketHashMap::Iterator::operator ++(int)");
+    }
+    if (current.block == nullptr){
+        return *this;
+    }
+    Iterator to_return(*this);
+    if (can_erase){
+        bucket_advance(ref_map->map, ref_map->bins, current, false);
+    }
+    can_erase = true;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool BucketHashMap<KEY,T,thash>::Iterator::operator == (const BucketHashMap<KEY,T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("BucketHashMap::Iterator::operator ==");
+    }
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("BucketHashMap::Iterator::operator ==");
+    }
+    if (ref_map != rhsASI->ref_map){
+        throw ComparingDifferentIteratorsError("BucketHashMap::Iterator::operator ==");
+    }
+    return current.block == rhsASI->current.block and current.slot == rhsASI->current.slot;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool BucketHashMap<KEY,T,thash>::Iterator::operator != (const BucketHashMap<KEY,T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("BucketHashMap::Iterator::operator !=");
+    }
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("BucketHashMap::Iterator::operator !=");
+    }
+    if (ref_map != rhsASI->ref_map){
+        throw ComparingDifferentIteratorsError("BucketHashMap::Iterator::operator !=");
+    }
+    return current.block != rhsASI->current.block or current.slot != rhsASI->current.slot;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+pair<KEY,T>& BucketHashMap<KEY,T,thash>::Iterator::operator *() const {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("BucketHashMap::Iterator::operator *");
+    }
+    if (!can_erase or current.block == nullptr){
+        throw IteratorPositionIllegal("BucketHashMap::Iterator::operator * Iterator illegal: exhausted");
+    }
+    return current.block->entry(current.slot);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+pair<KEY,T>* BucketHashMap<KEY,T,thash>::Iterator::operator ->() const {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("BucketHashMap::Iterator::operator ->");
+    }
+    if (!can_erase or current.block == nullptr){
+        throw IteratorPositionIllegal("BucketHashMap::Iterator::operator -> Iterator illegal: exhausted");
+    }
+    return &current.block->entry(current.slot);
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//BucketHashSet class and related definitions
+
+//Destructor/Constructors
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>::~BucketHashSet() {
+    delete_hash_table(set, bins);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>::BucketHashSet(double the_load_threshold, int (*chash)(const T& element))
+:   hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashSet::default constructor: neither specified");
+    }
+    if (thash != undefinedhash<T> and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashSet::default constructor: both specified and different");
+    }
+    set = new Block[bins];
+}
+
+
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>::BucketHashSet(int initial_bins, double the_load_threshold, int (*chash)(const T& element))
+:   hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashSet::length constructor: neither specified");
+    }
+    if (thash != undefinedhash<T> and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashSet::length constructor: both specified and different");
+    }
+    bins = bin_count<true>(std::size_t(std::max(1, initial_bins)));
+    set  = new Block[bins];
+}
+
+
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>::BucketHashSet(const BucketHashSet<T,thash>& to_copy, double the_load_threshold, int (*chash)(const T& element))
+:   hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        hash = to_copy.hash;
+    }
+    if (thash != undefinedhash<T> and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashSet::copy constructor: both specified and different");
+    }
+    bins = bins_for(to_copy.used);
+    set  = new Block[bins];
+    copy_elements(to_copy);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>::BucketHashSet(const std::initializer_list<T>& il, double the_load_threshold, int (*chash)(const T& element))
+:   hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashSet::initializer_list constructor: neither specified");
+    }
+    if (thash != undefinedhash<T> and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashSet::initializer_list constructor: both specified and different");
+    }
+    bins = bins_for(il.size());
+    set  = new Block[bins];
+    insert_all(il);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class Iterable>
+BucketHashSet<T,thash>::BucketHashSet(const Iterable& i, double the_load_threshold, int (*chash)(const T& a))
+:   hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("BucketHashSet::Iterable constructor: neither specified");
+    }
+    if (thash != undefinedhash<T> and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("BucketHashSet::Iterable constructor: both specified and different");
+    }
+    bins = bins_for(i.size());
+    set  = new Block[bins];
+    insert_all(i);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Queries
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::empty() const {
+    return used == 0;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::size_t BucketHashSet<T,thash>::size() const {
+    return used;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::contains (const T& element) const {
+    return find_element(element).block != nullptr;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::string BucketHashSet<T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "BucketHashSet[";
+    for (std::size_t i = 0; i < bins; i++){
+        answer << std::endl << "  bin[" << i << "]:";
+        for (Block* b = &set[i]; b != nullptr; b = b->next){
+            answer << " |";
+            for (int s = 0; s < Block::slots; s++){
+                if (b->tag[s] != 0){
+                    answer << " " << b->entry(s);
+                }
+                else{
+                    answer << " -";
+                }
+            }
+        }
+    }
+    answer << "](load_threshold=" << load_threshold << ",bins=" << bins << ",slots=" << Block::slots
+           << ",used=" << used << ",mod_count=" << mod_count << ")";
+    return answer.str();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template <class Iterable>
+bool BucketHashSet<T,thash>::contains_all(const Iterable& i) const {
+    for (const T& v : i){
+        if (!contains(v)){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Commands
+
+template<class T, int (*thash)(const T& a)>
+int BucketHashSet<T,thash>::insert(const T& element) {
+    if (find_element(element).block != nullptr){
+        return 0;
+    }
+
+    ensure_load_threshold(used + 1);
+    place(set, bins, hash(element), element);
+    used++;
+    mod_count++;
+    return 1;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int BucketHashSet<T,thash>::erase(const T& element) {
+    Cursor c = find_element(element);
+    if (c.block == nullptr){
+        return 0;
+    }
+
+    erase_at(c);
+    mod_count++;
+    return 1;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void BucketHashSet<T,thash>::clear() {
+    delete_hash_table(set, bins);
+    set = new Block[bins];
+    mod_count++;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class Iterable>
+std::size_t BucketHashSet<T,thash>::insert_all(const Iterable& i) {
+    std::size_t count = 0;
+    for (const T& v : i){
+        count += insert(v);
+    }
+    return count;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class Iterable>
+std::size_t BucketHashSet<T,thash>::erase_all(const Iterable& i) {
+    std::size_t count = 0;
+    for (const T& v : i){
+        count += erase(v);
+    }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Operators
+
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>& BucketHashSet<T,thash>::operator = (const BucketHashSet<T,thash>& rhs) {
+    if (this == &rhs){
+        return *this;
+    }
+    delete_hash_table(set, bins);
+    bins = bins_for(rhs.used);
+    set  = new Block[bins];
+    copy_elements(rhs);
+    mod_count++;
+    return *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::operator == (const BucketHashSet<T,thash>& rhs) const {
+    if (this == &rhs){
+        return true;
+    }
+    if (used != rhs.size()){
+        return false;
+    }
+    return rhs.contains_all(*this);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::operator != (const BucketHashSet<T,thash>& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::operator <= (const BucketHashSet<T,thash>& rhs) const {
+    if (this == &rhs){
+        return true;
+    }
+    if (used > rhs.size()){
+        return false;
+    }
+    return rhs.contains_all(*this);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::operator < (const BucketHashSet<T,thash>& rhs) const {
+    return used < rhs.size() and *this <= rhs;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::operator >= (const BucketHashSet<T,thash>& rhs) const {
+    return rhs <= *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::operator > (const BucketHashSet<T,thash>& rhs) const {
+    return rhs < *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::ostream& operator << (std::ostream& outs, const BucketHashSet<T,thash>& s) {
+    outs << "set[";
+    bool first = true;
+    for (const T& v : s){
+        outs << (first ? "" : ",") << v;
+        first = false;
+    }
+    outs << "]";
+    return outs;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator constructors
+
+template<class T, int (*thash)(const T& a)>
+auto BucketHashSet<T,thash>::begin () const -> BucketHashSet<T,thash>::Iterator {
+    return Iterator(const_cast<BucketHashSet<T,thash>*>(this), true);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+auto BucketHashSet<T,thash>::end () const -> BucketHashSet<T,thash>::Iterator {
+    return Iterator(const_cast<BucketHashSet<T,thash>*>(this), false);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Private helper methods
+
+template<class T, int (*thash)(const T& a)>
+std::size_t BucketHashSet<T,thash>::bins_for (std::size_t count) const {
+    return bin_count<true>(std::size_t(std::min(double(max_bins<std::size_t>()), double(count) / (load_threshold * Block::slots))));
+}
+
+
+template<class T, int (*thash)(const T& a)>
+auto BucketHashSet<T,thash>::find_element (const T& element) const -> Cursor {
+    int           hashed = hash(element);
+    std::size_t   bin    = hash_bin<true>(hashed, bins);
+    unsigned char tag    = bucket_tag(hashed);
+    for (Block* b = &set[bin]; b != nullptr; b = b->next){
+        for (int s = 0; s < Block::slots; s++){
+            if (b->tag[s] == tag and element == b->entry(s)){
+                return Cursor(bin, b, s);
+            }
+        }
+    }
+    return Cursor(bin, nullptr, 0);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class... Args>
+T& BucketHashSet<T,thash>::place (Block* ht, std::size_t bins, int hashed, Args&&... args) {
+    Block* head = &ht[hash_bin<true>(hashed, bins)];
+    for (Block* b = head; b != nullptr; b = b->next){
+        for (int s = 0; s < Block::slots; s++){
+            if (b->tag[s] == 0){
+                return b->make(s, bucket_tag(hashed), std::forward<Args>(args)...);
+            }
+        }
+    }
+
+    //Every block is full: link a new one right after the first (which is in the array)
+    Block* b   = pool.make();
+    b->next    = head->next;
+    head->next = b;
+    return b->make(0, bucket_tag(hashed), std::forward<Args>(args)...);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void BucketHashSet<T,thash>::erase_at (const Cursor& c) {
+    c.block->destroy(c.slot);
+    used--;
+    Block* head = &set[c.bin];
+    if (c.block != head and c.block->empty()){
+        Block* prev = head;
+        while (prev->next != c.block){
+            prev = prev->next;
+        }
+        prev->next = c.block->next;
+        pool.recycle(c.block);
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void BucketHashSet<T,thash>::copy_elements (const BucketHashSet<T,thash>& from) {
+    for (const T& v : from){
+        place(set, bins, hash(v), v);
+        used++;
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void BucketHashSet<T,thash>::ensure_load_threshold(std::size_t new_used) {
+    if (double(new_used) <= load_threshold * double(bins) * Block::slots or bins >= max_bins<std::size_t>()){
+        return;
+    }
+    rehash(bins * 2);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void BucketHashSet<T,thash>::rehash (std::size_t new_bins) {
+    Block*      old_set  = set;
+    std::size_t old_bins = bins;
+
+    set  = new Block[new_bins];
+    bins = new_bins;
+    for (std::size_t i = 0; i < old_bins; i++){
+        for (Block* b = &old_set[i]; b != nullptr; ){
+            for (int s = 0; s < Block::slots; s++){
+                if (b->tag[s] != 0){
+                    T& v = b->entry(s);
+                    place(set, bins, hash(v), std::move(v));
+                    b->destroy(s);
+                }
+            }
+            Block* to_recycle = b;
+            b = b->next;
+            if (to_recycle != &old_set[i]){
+                pool.recycle(to_recycle);
+            }
+        }
+    }
+    delete[] old_set;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void BucketHashSet<T,thash>::delete_hash_table (Block*& ht, std::size_t bins) {
+    for (std::size_t i = 0; i < bins; i++){
+        for (Block* b = &ht[i]; b != nullptr; ){
+            for (int s = 0; s < Block::slots; s++){
+                if (b->tag[s] != 0){
+                    b->destroy(s);
+                }
+            }
+            Block* to_recycle = b;
+            b = b->next;
+            if (to_recycle != &ht[i]){
+                pool.recycle(to_recycle);
+            }
+        }
+    }
+    delete[] ht;
+    ht   = nullptr;
+    used = 0;
+}
+
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator class definitions
+
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>::Iterator::Iterator(BucketHashSet<T,thash>* iterate_over, bool from_begin)
+        : ref_set(iterate_over), expected_mod_count(ref_set->mod_count) {
+    if (from_begin){
+        bucket_advance(ref_set->set, ref_set->bins, current, true);
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+BucketHashSet<T,thash>::Iterator::~Iterator()
+{}
+
+
+template<class T, int (*thash)(const T& a)>
+T BucketHashSet<T,thash>::Iterator::erase() {
+    if (expected_mod_count != ref_set->mod_count){
+        throw ConcurrentModificationError("BucketHashSet::Iterator::erase");
+    }
+    if (!can_erase){
+        throw CannotEraseError("BucketHashSet::Iterator::erase Iterator cursor already erased");
+    }
+    if (current.block == nullptr){
+        throw CannotEraseError("BucketHashSet::Iterator::erase Iterator cursor beyond data structure");
+    }
+
+    //As in BucketHashMap::Iterator::erase: advance first, then erase the old position
+    can_erase = false;
+    Cursor to_erase  = current;
+    T      to_return = to_erase.block->entry(to_erase.slot);
+    bucket_advance(ref_set->set, ref_set->bins, current, false);
+    ref_set->erase_at(to_erase);
+    ref_set->mod_count++;
+    expected_mod_count = ref_set->mod_count;
+    return to_return;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::string BucketHashSet<T,thash>::Iterator::str() const {
+    std::ostringstream answer;
+    answer << ref_set->str() << "(current=" << current.bin << "/" << current.slot << ",expected_mod_count=" << expected_mod_count << ",can_erase=" << can_erase << ")";
+    return answer.str();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+auto BucketHashSet<T,thash>::Iterator::operator ++ () -> BucketHashSet<T,thash>::Iterator& {
+    if (expected_mod_count != ref_set->mod_count){
+        throw ConcurrentModificationError("BucketHashSet::Iterator::operator ++");
+    }
+    if (current.block == nullptr){
+        return *this;
+    }
+    if (can_erase){
+        bucket_advance(ref_set->set, ref_set->bins, current, false);
+    }
+    can_erase = true;
+    return *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+auto BucketHashSet<T,thash>::Iterator::operator ++ (int) -> BucketHashSet<T,thash>::Iterator {
+    if (expected_mod_count != ref_set->mod_count){
+        throw ConcurrentModificationError("BucketHashSet::Iterator::operator ++(int)");
+    }
+    if (current.block == nullptr){
+        return *this;
+    }
+    Iterator to_return(*this);
+    if (can_erase){
+        bucket_advance(ref_set->set, ref_set->bins, current, false);
+    }
+    can_erase = true;
+    return to_return;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::Iterator::operator == (const BucketHashSet<T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("BucketHashSet::Iterator::operator ==");
+    }
+    if (expected_mod_count != ref_set->mod_count){
+        throw ConcurrentModificationError("BucketHashSet::Iterator::operator ==");
+    }
+    if (ref_set != rhsASI->ref_set){
+        throw ComparingDifferentIteratorsError("BucketHashSet::Iterator::operator ==");
+    }
+    return current.block == rhsASI->current.block and current.slot == rhsASI->current.slot;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool BucketHashSet<T,thash>::Iterator::operator != (const BucketHashSet<T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("BucketHashSet::Iterator::operator !=");
+    }
+    if (expected_mod_count != ref_set->mod_count){
+        throw ConcurrentModificationError("BucketHashSet::Iterator::operator !=");
+    }
+    if (ref_set != rhsASI->ref_set){
+        throw ComparingDifferentIteratorsError("BucketHashSet::Iterator::operator !=");
+    }
+    return current.block != rhsASI->current.block or current.slot != rhsASI->current.slot;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+T& BucketHashSet<T,thash>::Iterator::operator *() const {
+    if (expected_mod_count != ref_set->mod_count){
+        throw ConcurrentModificationError("BucketHashSet::Iterator::operator *");
+    }
+    if (!can_erase or current.block == nullptr){
+        throw IteratorPositionIllegal("BucketHashSet::Iterator::operator * Iterator illegal: exhausted");
+    }
+    return current.block->entry(current.slot);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+T* BucketHashSet<T,thash>::Iterator::operator ->() const {
+    if (expected_mod_count != ref_set->mod_count){
+        throw ConcurrentModificationError("BucketHashSet::Iterator::operator ->");
+    }
+    if (!can_erase or current.block == nullptr){
+        throw IteratorPositionIllegal("BucketHashSet::Iterator::operator -> Iterator illegal: exhausted");
+    }
+    return &current.block->entry(current.slot);
+}
+
+}
+
+#endif /* BUCKET_HASH_MAP_HPP_ */
@@ -0,0 +1,449 @@
+#ifndef CONCURRENT_HASH_MAP_HPP_
+#define CONCURRENT_HASH_MAP_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <thread>
+#include "ics_exceptions.hpp"
+#include "pair.hpp"
+#include "hashing.hpp"
+#include "hashmap.hpp"
+
+
+namespace ics {
+
+
+//A ConcurrentHashMap can be used by many threads at once. It is made of shards: each shard is an
+//  ordinary HashMap guarded by its own mutex, and each key belongs to exactly one shard (chosen by
+//  the high bits of its mixed hash), so threads using keys in different shards never wait for each other.
+//thash/chash are specified as in HashMap; each shard uses the same hash function.
+//Every operation locks only its key's shard, so values are returned by copy (a reference would
+//  outlive the lock). There is no operator []: use get/put/compute_if_absent.
+//size/empty/snapshot/begin lock the shards one at a time: under concurrent modification, the result
+//  reflects each shard at some moment, but not all shards at the same moment.
+template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class ConcurrentHashMap {
+  public:
+    typedef ics::pair<KEY,T>       Entry;
+    typedef HashMap<KEY,T,thash>   Snapshot;
+    typedef int (*hashfunc) (const KEY& a);
+
+    //Destructor/Constructors
+    //shard_count <= 0 scales the # of shards with std::thread::hardware_concurrency (see default_shards);
+    //  any shard_count is rounded up to a power of two
+    ~ConcurrentHashMap ();
+    explicit ConcurrentHashMap (int shard_count = 0, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+    ConcurrentHashMap          (const ConcurrentHashMap<KEY,T,thash>& to_copy)             = delete;
+    ConcurrentHashMap<KEY,T,thash>& operator = (const ConcurrentHashMap<KEY,T,thash>& rhs) = delete;
+
+
+    //Queries
+    bool empty      () const;
+    std::size_t size () const;
+    int  shards     () const;
+    bool has_key    (const KEY& key) const;
+    T    get        (const KEY& key) const;           //Raises KeyError if key is not in the map
+    bool try_get    (const KEY& key, T& value) const; //Copies key's value into value; false if key is not in the map
+    Snapshot snapshot () const;                       //A (single-threaded) copy of every entry
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+
+    //Commands
+    T    put   (const KEY& key, const T& value);     //Returns key's old value (or value, if key was new)
+    T    erase (const KEY& key);                     //Raises KeyError if key is not in the map
+    void clear ();
+
+    //Returns key's value; if key is absent first puts it with value compute(key). compute is called at
+    //  most once, while key's shard is locked: it must not use this ConcurrentHashMap.
+    template <class Compute>
+    T compute_if_absent (const KEY& key, Compute compute);
+
+
+    //Iterators traverse a snapshot taken by begin (which the iterators share), so they are never
+    //  invalidated by concurrent modification, and never see it. They do not support erase.
+    class Iterator {
+      public:
+        std::string str  () const;
+        Iterator& operator ++ ();
+        Iterator  operator ++ (int);
+        bool operator == (const Iterator& rhs) const;
+        bool operator != (const Iterator& rhs) const;
+        const Entry& operator *  () const;
+        const Entry* operator -> () const;
+        friend std::ostream& operator << (std::ostream& outs, const Iterator& i) {
+          outs << i.str(); //Use the same meaning as the debugging .str() method
+          return outs;
+        }
+        friend Iterator ConcurrentHashMap<KEY,T,thash>::begin () const;
+        friend Iterator ConcurrentHashMap<KEY,T,thash>::end   () const;
+
+      private:
+        std::shared_ptr<const Snapshot>            snap;     //nullptr at end()
+        std::optional<typename Snapshot::Iterator> current;  //Into *snap, unless at end()
+
+        //Called in friends begin/end
+        Iterator(std::shared_ptr<const Snapshot> snapshot);
+    };
+
+    Iterator begin () const;
+    Iterator end   () const;
+
+    template<class KEY2,class T2, int (*hash2)(const KEY2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const ConcurrentHashMap<KEY2,T2,hash2>& m);
+
+
+  private:
+    //Each shard is aligned to its own cache lines, so locking one shard does not slow down threads
+    //  using its neighbors (false sharing)
+    class alignas(64) Shard {
+      public:
+        Shard (double the_load_threshold, int (*chash)(const KEY& a)) : map(the_load_threshold, chash) {}
+
+        mutable std::mutex   lock;
+        HashMap<KEY,T,thash> map;
+    };
+
+    static constexpr int MAX_SHARDS = 1 << 12;
+
+    HashFunction<KEY,thash> hash; //Hashing function used (from template or constructor)
+    double load_threshold;       //For each shard's HashMap (and snapshots)
+    Shard** shard_table = nullptr;
+    int     shard_count = 1;     //A power of two
+    int     shard_shift = 32;    //shard index = hash_mix(hash) >> shard_shift (unused when shard_count == 1)
+
+    //Helper methods
+    static int default_shards ();               //4 shards per hardware thread
+    Shard&     shard_of       (const KEY& key) const;
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//ConcurrentHashMap class and related definitions
+
+//Destructor/Constructors
+template<class KEY,class T, int (*thash)(const KEY& a)>
+ConcurrentHashMap<KEY,T,thash>::~ConcurrentHashMap() {
+    for (int i = 0; i < shard_count; i++){
+        delete shard_table[i];
+    }
+    delete[] shard_table;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+ConcurrentHashMap<KEY,T,thash>::ConcurrentHashMap(int the_shard_count, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("ConcurrentHashMap::constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("ConcurrentHashMap::constructor: both specified and different");
+    }
+
+    shard_count = bin_count<true>(std::min(the_shard_count <= 0 ? default_shards() : the_shard_count, int(MAX_SHARDS)));
+    for (int n = shard_count; n > 1; n >>= 1){
+        shard_shift--;
+    }
+
+    shard_table = new Shard* [shard_count]();
+    try{
+        for (int i = 0; i < shard_count; i++){
+            shard_table[i] = new Shard(load_threshold, chash);
+        }
+    }catch (...){
+        for (int i = 0; i < shard_count; i++){
+            delete shard_table[i];
+        }
+        delete[] shard_table;
+        throw;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Queries
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool ConcurrentHashMap<KEY,T,thash>::empty() const {
+    for (int i = 0; i < shard_count; i++){
+        std::lock_guard<std::mutex> guard(shard_table[i] -> lock);
+        if (!shard_table[i] -> map.empty()){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t ConcurrentHashMap<KEY,T,thash>::size() const {
+    std::size_t count = 0;
+    for (int i = 0; i < shard_count; i++){
+        std::lock_guard<std::mutex> guard(shard_table[i] -> lock);
+        count += shard_table[i] -> map.size();
+    }
+    return count;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+int ConcurrentHashMap<KEY,T,thash>::shards() const {
+    return shard_count;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool ConcurrentHashMap<KEY,T,thash>::has_key(const KEY& key) const {
+    Shard& s = shard_of(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.map.has_key(key);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T ConcurrentHashMap<KEY,T,thash>::get(const KEY& key) const {
+    Shard& s = shard_of(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    const T* value = s.map.find(key);
+    if (value == nullptr){
+        std::ostringstream answer;
+        answer << "ConcurrentHashMap::get: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return *value;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool ConcurrentHashMap<KEY,T,thash>::try_get(const KEY& key, T& value) const {
+    Shard& s = shard_of(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    const T* found = s.map.find(key);
+    if (found == nullptr){
+        return false;
+    }
+    value = *found;
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::snapshot() const -> Snapshot {
+    Snapshot answer(load_threshold, hash);
+    for (int i = 0; i < shard_count; i++){
+        std::lock_guard<std::mutex> guard(shard_table[i] -> lock);
+        for (const Entry& m_entry : shard_table[i] -> map){
+            answer.put(m_entry.first, m_entry.second);
+        }
+    }
+    return answer;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string ConcurrentHashMap<KEY,T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "ConcurrentHashMap[";
+    for (int i = 0; i < shard_count; i++){
+        std::lock_guard<std::mutex> guard(shard_table[i] -> lock);
+        answer << std::endl << "  shard[" << i << "]: size = " << shard_table[i] -> map.size();
+    }
+    answer << "](shard_count=" << shard_count << ",load_threshold=" << load_threshold << ")";
+    return answer.str();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Commands
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T ConcurrentHashMap<KEY,T,thash>::put(const KEY& key, const T& value) {
+    Shard& s = shard_of(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.map.put(key, value);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T ConcurrentHashMap<KEY,T,thash>::erase(const KEY& key) {
+    Shard& s = shard_of(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    try{
+        return s.map.erase(key);
+    }catch (const KeyError&){
+        std::ostringstream answer;
+        answer << "ConcurrentHashMap::erase: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void ConcurrentHashMap<KEY,T,thash>::clear() {
+    for (int i = 0; i < shard_count; i++){
+        std::lock_guard<std::mutex> guard(shard_table[i] -> lock);
+        shard_table[i] -> map.clear();
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class Compute>
+T ConcurrentHashMap<KEY,T,thash>::compute_if_absent(const KEY& key, Compute compute) {
+    Shard& s = shard_of(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.map.compute_if_absent(key, compute);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Operators
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::ostream& operator << (std::ostream& outs, const ConcurrentHashMap<KEY,T,thash>& m) {
+    outs << "map[";
+    bool first = true;
+    for (const auto& m_entry : m){
+        outs << (first ? "" : ",") << m_entry.first << "->" << m_entry.second;
+        first = false;
+    }
+    outs << "]";
+    return outs;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator constructors
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::begin () const -> ConcurrentHashMap<KEY,T,thash>::Iterator {
+    return Iterator(std::make_shared<const Snapshot>(snapshot()));
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::end () const -> ConcurrentHashMap<KEY,T,thash>::Iterator {
+    return Iterator(nullptr);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Private helper methods
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+int ConcurrentHashMap<KEY,T,thash>::default_shards () {
+    int threads = int(std::thread::hardware_concurrency());
+    return 4 * (threads > 0 ? threads : 1);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::shard_of (const KEY& key) const -> Shard& {
+    //The high bits choose the shard; each shard's HashMap uses the low bits of the same mix for its bins
+    if (shard_count == 1){
+        return *shard_table[0];
+    }
+    return *shard_table[hash_mix(hash(key)) >> shard_shift];
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator class definitions
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+ConcurrentHashMap<KEY,T,thash>::Iterator::Iterator(std::shared_ptr<const Snapshot> snapshot)
+:   snap(snapshot){
+    if (snap != nullptr){
+        current = snap -> begin();
+        if (*current == snap -> end()){
+            snap = nullptr;
+            current.reset();
+        }
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string ConcurrentHashMap<KEY,T,thash>::Iterator::str() const {
+    std::ostringstream answer;
+    answer << "ConcurrentHashMap::Iterator(" << (snap == nullptr ? std::string("end") : current -> str()) << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::Iterator::operator ++ () -> ConcurrentHashMap<KEY,T,thash>::Iterator& {
+    if (snap == nullptr){
+        return *this;
+    }
+    ++*current;
+    if (*current == snap -> end()){
+        snap = nullptr;
+        current.reset();
+    }
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::Iterator::operator ++ (int) -> ConcurrentHashMap<KEY,T,thash>::Iterator {
+    Iterator to_return(*this);
+    ++(*this);
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool ConcurrentHashMap<KEY,T,thash>::Iterator::operator == (const Iterator& rhs) const {
+    if (snap == nullptr or rhs.snap == nullptr){
+        return snap == rhs.snap;
+    }
+    if (snap != rhs.snap){
+        throw ComparingDifferentIteratorsError("ConcurrentHashMap::Iterator::operator ==");
+    }
+    return *current == *rhs.current;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool ConcurrentHashMap<KEY,T,thash>::Iterator::operator != (const Iterator& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::Iterator::operator *() const -> const Entry& {
+    if (snap == nullptr){
+        throw IteratorPositionIllegal("ConcurrentHashMap::Iterator::operator *: Iterator illegal: end");
+    }
+    return **current;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto ConcurrentHashMap<KEY,T,thash>::Iterator::operator ->() const -> const Entry* {
+    if (snap == nullptr){
+        throw IteratorPositionIllegal("ConcurrentHashMap::Iterator::operator ->: Iterator illegal: end");
+    }
+    return &**current;
+}
+
+}
+
+#endif /* CONCURRENT_HASH_MAP_HPP_ */
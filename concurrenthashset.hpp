@@ -0,0 +1,436 @@
+#ifndef CONCURRENT_HASH_SET_HPP_
+#define CONCURRENT_HASH_SET_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include "ics_exceptions.hpp"
+#include "hashing.hpp"
+#include "hashset.hpp"
+
+
+namespace ics {
+
+
+#ifndef undefinedhashdefined
+#define undefinedhashdefined
+template<class T>
+hash_t<T> undefinedhash (const T& a) {return 0;}
+#endif /* undefinedhashdefined */
+
+//A ConcurrentHashSet is built for many threads calling contains while a few threads insert/erase.
+//Readers (contains, size, empty, snapshot) take no locks: the table and every bin/next pointer are
+//  atomics, so a reader always follows a consistent chain even while a writer links in a new node
+//  or unlinks an erased one. Writers (insert, erase, clear) are serialized by one mutex.
+//Growing builds a complete new table (with new nodes) and publishes it with one atomic store, so
+//  readers never wait for it: readers already in the old table finish there.
+//Memory is reclaimed by epochs: each reader announces itself (in one of STRIPES counters, so readers
+//  on different cores do not fight over one cache line) for the epoch it started in. Erased nodes and
+//  replaced tables are retired, and freed only after a writer advances the epoch and waits for every
+//  reader of the previous epoch to finish (synchronize). Writers never free memory a reader can see.
+//The destructor must not run while any other thread is still using the set.
+//
+//Instantiate the templated class supplying thash(a): produces a hash value for a.
+//If thash is defaulted to undefinedhash in the template, then a constructor must supply chash.
+//If both thash and chash are supplied, then they must be the same (by ==) function.
+//If neither is supplied, or both are supplied but different, TemplateFunctionError is raised.
+template<class T, int (*thash)(const T& a) = undefinedhash<T>> class ConcurrentHashSet {
+  public:
+    typedef int (*hashfunc) (const T& a);
+
+    //Destructor/Constructors
+    ~ConcurrentHashSet ();
+    ConcurrentHashSet (double the_load_threshold = 1.0, int (*chash)(const T& a) = nullptr);
+    ConcurrentHashSet (const ConcurrentHashSet<T,thash>& to_copy)                           = delete;
+    ConcurrentHashSet<T,thash>& operator = (const ConcurrentHashSet<T,thash>& rhs)          = delete;
+
+
+    //Queries (lock-free)
+    bool empty      () const;
+    int  size       () const;
+    bool contains   (const T& element) const;
+    HashSet<T,thash> snapshot () const;  //A (single-threaded) copy of the elements
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+
+    //Commands (serialized by a mutex)
+    int  insert (const T& element);      //Returns 1 if element was new; else 0
+    int  erase  (const T& element);      //Returns 1 if element was present; else 0
+    void clear  ();
+
+    template<class T2, int (*hash2)(const T2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const ConcurrentHashSet<T2,hash2>& s);
+
+
+  private:
+    class LN {
+      public:
+        LN (const T& v, int h, LN* n) : value(v), hashed(h) {next.store(n, std::memory_order_relaxed);}
+
+        const T          value;
+        const int        hashed;   //hash(value)
+        std::atomic<LN*> next;
+    };
+
+    class Table {
+      public:
+        explicit Table (int n) : bins(n), bin(new std::atomic<LN*>[n]) {
+          for (int i = 0; i < bins; i++){
+            bin[i].store(nullptr, std::memory_order_relaxed);
+          }
+        }
+        ~Table () {delete[] bin;}
+
+        const int         bins;    //A power of two
+        std::atomic<LN*>* bin;     //Each bin stores a nullptr-terminated list
+        Table*            next_retired = nullptr;
+    };
+
+    //The readers of epoch e are counted in count[e % 2] (of their thread's stripe)
+    class alignas(64) ReaderCount {
+      public:
+        std::atomic<int> count[2] = {};
+    };
+
+    //Announces a reader for its whole lifetime (so retired memory it can reach is not freed)
+    class ReadGuard {
+      public:
+        explicit ReadGuard (const ConcurrentHashSet<T,thash>& s);
+        ~ReadGuard ();
+      private:
+        std::atomic<int>* counter;
+    };
+
+    class Retired {
+      public:
+        LN*      node;
+        Retired* next;
+    };
+
+    static constexpr int STRIPES       = 16;
+    static constexpr int RECLAIM_BATCH = 64;    //synchronize after retiring this many erased nodes
+
+    HashFunction<T,thash> hash;                 //Hashing function used (from template or constructor)
+    double load_threshold;                      //used/bins <= load_threshold
+    std::atomic<Table*> table;                  //The current table (readers load it once per operation)
+    std::atomic<int>    used{0};                //Cache for number of elements in the table
+    std::mutex          write_lock;             //Held by insert/erase/clear
+
+    mutable ReaderCount readers[STRIPES];
+    std::atomic<std::uint64_t> epoch{0};        //Advanced by each synchronize (64-bit unsigned, so it cannot overflow)
+    Retired*            retired_nodes  = nullptr;   //Erased nodes waiting for synchronize (write_lock held)
+    Table*              retired_tables = nullptr;   //Replaced tables (with their nodes) waiting for synchronize
+    int                 retired_count  = 0;
+
+    //Helper methods
+    static int reader_stripe ();                                  //This thread's stripe in readers
+    LN*   find_element  (Table* t, const T& element, int hashed) const;
+    void  grow          ();                                       //Publish a table with twice the bins
+    void  retire        (LN* node);
+    void  retire        (Table* t);
+    void  synchronize   ();                                       //Free everything retired (waits for old readers)
+    static void delete_table (Table* t);                          //Deallocate t and all the LN in it
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//ConcurrentHashSet class and related definitions
+
+//Destructor/Constructors
+template<class T, int (*thash)(const T& a)>
+ConcurrentHashSet<T,thash>::~ConcurrentHashSet() {
+    synchronize();
+    delete_table(table.load(std::memory_order_relaxed));
+}
+
+
+template<class T, int (*thash)(const T& a)>
+ConcurrentHashSet<T,thash>::ConcurrentHashSet(double the_load_threshold, int (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
+    if (hash == nullptr) {
+        throw TemplateFunctionError("ConcurrentHashSet::default constructor: neither specified");
+    }
+    if (thash != undefinedhash<T> && chash != nullptr && chash != thash) {
+        throw TemplateFunctionError("ConcurrentHashSet::default constructor: both specified and different");
+    }
+    table.store(new Table(1), std::memory_order_relaxed);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Queries
+
+template<class T, int (*thash)(const T& a)>
+bool ConcurrentHashSet<T,thash>::empty() const {
+    return used.load(std::memory_order_relaxed) == 0;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int ConcurrentHashSet<T,thash>::size() const {
+    return used.load(std::memory_order_relaxed);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool ConcurrentHashSet<T,thash>::contains (const T& element) const {
+    int hashed = hash(element);
+    ReadGuard guard(*this);
+    return find_element(table.load(std::memory_order_acquire), element, hashed) != nullptr;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+HashSet<T,thash> ConcurrentHashSet<T,thash>::snapshot() const {
+    HashSet<T,thash> answer(load_threshold, hash);
+    ReadGuard guard(*this);
+    Table* t = table.load(std::memory_order_acquire);
+    for (int i = 0; i < t->bins; ++i) {
+        for (LN* c = t->bin[i].load(std::memory_order_acquire); c != nullptr; c = c->next.load(std::memory_order_acquire)) {
+            answer.insert(c->value);
+        }
+    }
+    return answer;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::string ConcurrentHashSet<T,thash>::str() const {
+    std::ostringstream answer;
+    ReadGuard guard(*this);
+    Table* t = table.load(std::memory_order_acquire);
+    answer << "ConcurrentHashSet[";
+    for (int i = 0; i < t->bins; ++i) {
+        answer << std::endl << "  bin[" << i << "]: ";
+        const char* separator = "";
+        for (LN* c = t->bin[i].load(std::memory_order_acquire); c != nullptr; c = c->next.load(std::memory_order_acquire)) {
+            answer << separator << c->value;
+            separator = " -> ";
+        }
+    }
+    answer << "](used=" << size() << ",bins=" << t->bins << ",epoch=" << epoch.load(std::memory_order_relaxed) << ")";
+    return answer.str();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Commands
+
+template<class T, int (*thash)(const T& a)>
+int ConcurrentHashSet<T,thash>::insert(const T& element) {
+    int hashed = hash(element);
+    std::lock_guard<std::mutex> lock(write_lock);
+    if (find_element(table.load(std::memory_order_relaxed), element, hashed) != nullptr) {
+        return 0;
+    }
+
+    if (used.load(std::memory_order_relaxed) + 1 > load_threshold * table.load(std::memory_order_relaxed)->bins) {
+        grow();
+    }
+    Table* t = table.load(std::memory_order_relaxed);
+    std::atomic<LN*>& head = t->bin[hash_bin<true>(hashed, t->bins)];
+    //The node is complete before the release store makes it reachable
+    head.store(new LN(element, hashed, head.load(std::memory_order_relaxed)), std::memory_order_release);
+    used.store(used.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return 1;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int ConcurrentHashSet<T,thash>::erase(const T& element) {
+    int hashed = hash(element);
+    std::lock_guard<std::mutex> lock(write_lock);
+    Table* t = table.load(std::memory_order_relaxed);
+    std::atomic<LN*>* link = &t->bin[hash_bin<true>(hashed, t->bins)];
+    for (LN* c = link->load(std::memory_order_relaxed); c != nullptr; link = &c->next, c = link->load(std::memory_order_relaxed)) {
+        if (c->hashed == hashed && c->value == element) {
+            //Readers at c still follow c->next (which is unchanged) to the rest of the chain
+            link->store(c->next.load(std::memory_order_relaxed), std::memory_order_release);
+            used.store(used.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            retire(c);
+            if (retired_count >= RECLAIM_BATCH) {
+                synchronize();
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void ConcurrentHashSet<T,thash>::clear() {
+    std::lock_guard<std::mutex> lock(write_lock);
+    Table* old_table = table.load(std::memory_order_relaxed);
+    table.store(new Table(1), std::memory_order_release);
+    used.store(0, std::memory_order_relaxed);
+    retire(old_table);
+    synchronize();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Operators
+
+template<class T, int (*thash)(const T& a)>
+std::ostream& operator << (std::ostream& outs, const ConcurrentHashSet<T,thash>& s) {
+    outs << "set[";
+    bool first = true;
+    typename ConcurrentHashSet<T,thash>::ReadGuard guard(s);
+    auto t = s.table.load(std::memory_order_acquire);
+    for (int i = 0; i < t->bins; ++i) {
+        for (auto c = t->bin[i].load(std::memory_order_acquire); c != nullptr; c = c->next.load(std::memory_order_acquire)) {
+            outs << (first ? "" : ",") << c->value;
+            first = false;
+        }
+    }
+    outs << "]";
+    return outs;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//ReadGuard definitions
+
+template<class T, int (*thash)(const T& a)>
+ConcurrentHashSet<T,thash>::ReadGuard::ReadGuard (const ConcurrentHashSet<T,thash>& s) {
+    std::atomic<int>* count = s.readers[reader_stripe()].count;
+    //Announce, then check that the epoch did not advance meanwhile: otherwise a writer may have
+    //  missed this reader while waiting for the old epoch's readers, so announce again
+    for (;;) {
+        std::uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+        counter = &count[e & 1];
+        counter->fetch_add(1, std::memory_order_seq_cst);
+        if (s.epoch.load(std::memory_order_seq_cst) == e) {
+            return;
+        }
+        counter->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+ConcurrentHashSet<T,thash>::ReadGuard::~ReadGuard () {
+    counter->fetch_sub(1, std::memory_order_release);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Private helper methods
+
+template<class T, int (*thash)(const T& a)>
+int ConcurrentHashSet<T,thash>::reader_stripe () {
+    static std::atomic<int> next_stripe{0};
+    thread_local int stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+    return stripe;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+typename ConcurrentHashSet<T,thash>::LN* ConcurrentHashSet<T,thash>::find_element (Table* t, const T& element, int hashed) const {
+    for (LN* c = t->bin[hash_bin<true>(hashed, t->bins)].load(std::memory_order_acquire); c != nullptr; c = c->next.load(std::memory_order_acquire)) {
+        if (c->hashed == hashed && c->value == element) {
+            return c;
+        }
+    }
+    return nullptr;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void ConcurrentHashSet<T,thash>::grow() {
+    Table* old_table = table.load(std::memory_order_relaxed);
+    if (old_table->bins > std::numeric_limits<int>::max() / 2) {
+        return;
+    }
+
+    //Copy the nodes: relinking the old ones would send readers still in old_table down the wrong chains
+    Table* new_table = new Table(2 * old_table->bins);
+    for (int i = 0; i < old_table->bins; ++i) {
+        for (LN* c = old_table->bin[i].load(std::memory_order_relaxed); c != nullptr; c = c->next.load(std::memory_order_relaxed)) {
+            std::atomic<LN*>& head = new_table->bin[hash_bin<true>(c->hashed, new_table->bins)];
+            head.store(new LN(c->value, c->hashed, head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        }
+    }
+
+    table.store(new_table, std::memory_order_release);
+    retire(old_table);
+    synchronize();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void ConcurrentHashSet<T,thash>::retire(LN* node) {
+    retired_nodes = new Retired{node, retired_nodes};
+    ++retired_count;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void ConcurrentHashSet<T,thash>::retire(Table* t) {
+    t->next_retired = retired_tables;
+    retired_tables  = t;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void ConcurrentHashSet<T,thash>::synchronize() {
+    if (retired_nodes == nullptr && retired_tables == nullptr) {
+        return;
+    }
+
+    //Readers that start from now on announce themselves in the other counters, and cannot reach
+    //  anything already retired; wait for the readers that started before
+    std::uint64_t e = epoch.load(std::memory_order_relaxed);
+    epoch.store(e + 1, std::memory_order_seq_cst);
+    for (int i = 0; i < STRIPES; ++i) {
+        while (readers[i].count[e & 1].load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    while (retired_nodes != nullptr) {
+        Retired* to_delete = retired_nodes;
+        retired_nodes = retired_nodes->next;
+        delete to_delete->node;
+        delete to_delete;
+    }
+    while (retired_tables != nullptr) {
+        Table* to_delete = retired_tables;
+        retired_tables = retired_tables->next_retired;
+        delete_table(to_delete);
+    }
+    retired_count = 0;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void ConcurrentHashSet<T,thash>::delete_table (Table* t) {
+    for (int i = 0; i < t->bins; ++i) {
+        LN* c = t->bin[i].load(std::memory_order_relaxed);
+        while (c != nullptr) {
+            LN* to_delete = c;
+            c = c->next.load(std::memory_order_relaxed);
+            delete to_delete;
+        }
+    }
+    delete t;
+}
+
+}
+
+#endif /* CONCURRENT_HASH_SET_HPP_ */
@@ -0,0 +1,577 @@
+#ifndef FROZEN_HASH_MAP_HPP_
+#define FROZEN_HASH_MAP_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "ics_exceptions.hpp"
+#include "pair.hpp"
+#include "hashing.hpp"
+#include "hashmap.hpp"
+#include "hashset.hpp"
+
+
+namespace ics {
+
+
+//PerfectHash maps each of a fixed collection of hash values to its own position, with no collisions
+//  and no unused positions (a minimal perfect hash built by hash-and-displace, as in CHD):
+//  - the distinct hash values are split into buckets of about 2 (by one mix of the hash value);
+//  - from the biggest bucket down, each bucket gets the first code for which the mix of each of
+//    its hash values with that code lands on a position no earlier bucket took;
+//  - buckets of one hash value just get a free position, stored directly in their code.
+//  So finding a position reads one code (about four bytes per key) and mixes twice: no probing.
+//Keys with the same hash value (but different keys) share a run of consecutive positions.
+//A hash value not in the collection also gets some position: the caller compares keys there.
+class PerfectHash {
+  public:
+    PerfectHash () {}
+
+    //Builds the hash for hashed (in any order, possibly with duplicates), and sets order so that
+    //  the key with hash value hashed[order[p]] should be stored at position p.
+    //Raises IcsError in the (practically impossible) case that no placement is found.
+    PerfectHash (const std::vector<int>& hashed, std::vector<std::size_t>& order);
+
+    //Sets [first,last) to the positions at which a key with this hash value can be
+    void positions (int hashed, std::size_t& first, std::size_t& last) const;
+
+    std::size_t codes_size  () const {return codes.size();}
+    std::size_t starts_size () const {return starts.size();}
+
+  private:
+    std::size_t                keys     = 0;  //# positions (hashed.size())
+    std::size_t                distinct = 0;  //# distinct hash values (at most 2^32), each with its own slot
+    std::size_t                buckets  = 1;
+    unsigned int               bucket_seed = 0;
+    std::vector<std::uint64_t> codes;   //Per bucket: even: mix code; odd: (slot << 1) | 1
+    std::vector<std::size_t>   starts;  //When some hash values repeat: slot s is positions [starts[s],starts[s+1])
+
+    static constexpr int max_tries = 1 << 16;  //Codes tried for a bucket before rebuilding with a new salt
+    static constexpr int max_salts = 64;       //Salts tried before rebuilding with twice the buckets
+
+    static std::size_t reduce (unsigned int x, std::size_t n) {return std::size_t((std::uint64_t(x) * n) >> 32);} //x ranged to [0,n-1] (n <= 2^32)
+    std::size_t bucket_of (int hashed) const {return reduce(hash_mix(int(unsigned(hashed) ^ bucket_seed)), buckets);}
+    std::size_t slot      (int hashed) const;
+    bool        place     (const std::vector<int>& values, unsigned int salt);  //false if some bucket could not be placed
+};
+
+
+//FrozenHashMap is an immutable copy of a HashMap (made by freeze(m)) for maps that are built once
+//  and then only read. Its entries are stored in one flat array, at the positions a PerfectHash
+//  gives their keys: a lookup reads a small code array and then one entry (with the key's hash value
+//  next to it), so it takes one probe, follows no chains, and allocates no LN per entry.
+//It uses the HashMap's hash function. Lookups (and iteration) see its entries in position order.
+template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class FrozenHashMap {
+  public:
+    typedef ics::pair<KEY,T>   Entry;
+    typedef int (*hashfunc) (const KEY& a);
+
+    explicit FrozenHashMap (const HashMap<KEY,T,thash>& to_freeze);
+
+
+    //Queries
+    bool empty      () const;
+    std::size_t size () const;
+    bool has_key    (const KEY& key) const;
+    bool has_value  (const T& value) const;
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+
+    //Operators
+    const T& operator [] (const KEY& key) const;   //Raises KeyError if key is not in the map
+    bool operator == (const FrozenHashMap<KEY,T,thash>& rhs) const;
+    bool operator != (const FrozenHashMap<KEY,T,thash>& rhs) const;
+
+    template<class KEY2,class T2, int (*hash2)(const KEY2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const FrozenHashMap<KEY2,T2,hash2>& m);
+
+
+  private:
+    class Slot {
+      public:
+        int   hashed;
+        Entry entry;
+    };
+
+  public:
+    //Iterates (read-only) over the entries
+    class Iterator {
+      public:
+        Iterator (const Slot* at) : at(at) {}
+        Iterator& operator ++ ()                          {++at; return *this;}
+        bool operator == (const Iterator& rhs) const      {return at == rhs.at;}
+        bool operator != (const Iterator& rhs) const      {return at != rhs.at;}
+        const Entry& operator *  () const                 {return at -> entry;}
+        const Entry* operator -> () const                 {return &at -> entry;}
+      private:
+        const Slot* at;
+    };
+
+    Iterator begin () const {return Iterator(slots.data());}
+    Iterator end   () const {return Iterator(slots.data() + slots.size());}
+
+
+  private:
+    HashFunction<KEY,thash> hash; //Hashing function used (from the frozen HashMap)
+    std::vector<Slot> slots;    //Each entry, at its PerfectHash position
+    PerfectHash       perfect;
+
+    const Slot* find_key (const KEY& key) const;  //Returns key's slot or nullptr
+};
+
+
+//FrozenHashSet is the same for a HashSet (made by freeze(s))
+template<class T, int (*thash)(const T& a) = undefinedhash<T>> class FrozenHashSet {
+  public:
+    typedef int (*hashfunc) (const T& a);
+
+    explicit FrozenHashSet (const HashSet<T,thash>& to_freeze);
+
+
+    //Queries
+    bool empty      () const;
+    std::size_t size () const;
+    bool contains   (const T& element) const;
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+
+    //Operators
+    bool operator == (const FrozenHashSet<T,thash>& rhs) const;
+    bool operator != (const FrozenHashSet<T,thash>& rhs) const;
+
+    template<class T2, int (*hash2)(const T2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const FrozenHashSet<T2,hash2>& s);
+
+
+  private:
+    class Slot {
+      public:
+        int hashed;
+        T   value;
+    };
+
+  public:
+    //Iterates (read-only) over the elements
+    class Iterator {
+      public:
+        Iterator (const Slot* at) : at(at) {}
+        Iterator& operator ++ ()                          {++at; return *this;}
+        bool operator == (const Iterator& rhs) const      {return at == rhs.at;}
+        bool operator != (const Iterator& rhs) const      {return at != rhs.at;}
+        const T& operator *  () const                     {return at->value;}
+        const T* operator -> () const                     {return &at->value;}
+      private:
+        const Slot* at;
+    };
+
+    Iterator begin () const {return Iterator(slots.data());}
+    Iterator end   () const {return Iterator(slots.data() + slots.size());}
+
+
+  private:
+    HashFunction<T,thash> hash; //Hashing function used (from the frozen HashSet)
+    std::vector<Slot> slots;    //Each element, at its PerfectHash position
+    PerfectHash       perfect;
+};
+
+
+//Return an immutable copy of m/s with perfect-hash lookups
+template<class KEY,class T, int (*thash)(const KEY& a)>
+FrozenHashMap<KEY,T,thash> freeze(const HashMap<KEY,T,thash>& m) {
+    return FrozenHashMap<KEY,T,thash>(m);
+}
+
+template<class T, int (*thash)(const T& a)>
+FrozenHashSet<T,thash> freeze(const HashSet<T,thash>& s) {
+    return FrozenHashSet<T,thash>(s);
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//PerfectHash definitions
+
+inline PerfectHash::PerfectHash (const std::vector<int>& hashed, std::vector<std::size_t>& order)
+: keys(hashed.size()) {
+    std::vector<int> values(hashed);
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    distinct = values.size();
+    buckets  = std::max(std::size_t(1), (distinct + 1) / 2);
+
+    //A failing salt is retried with the next one; after max_salts of them, smaller buckets (more of
+    //  them) are easier to place. With one bucket per value, failing every salt cannot happen in practice.
+    unsigned int salt = 0;
+    for (int failed = 1; !place(values, salt); failed++){
+        salt++;
+        if (failed % max_salts == 0){
+            if (buckets >= distinct){
+                throw IcsError("PerfectHash: no placement found for " + std::to_string(distinct) + " hash values");
+            }
+            buckets = std::min(distinct, buckets * 2);
+        }
+    }
+
+    order.resize(keys);
+    if (distinct == keys){
+        for (std::size_t i = 0; i < keys; i++){
+            order[slot(hashed[i])] = i;
+        }
+        return;
+    }
+
+    //Some hash values repeat: give each slot a run of positions (in the order the keys came)
+    starts.assign(distinct + 1, 0);
+    for (int h : hashed){
+        starts[slot(h) + 1]++;
+    }
+    for (std::size_t s = 0; s < distinct; s++){
+        starts[s + 1] += starts[s];
+    }
+    std::vector<std::size_t> next(starts.begin(), starts.end() - 1);
+    for (std::size_t i = 0; i < keys; i++){
+        order[next[slot(hashed[i])]++] = i;
+    }
+}
+
+
+inline void PerfectHash::positions (int hashed, std::size_t& first, std::size_t& last) const {
+    if (distinct == 0){
+        first = last = 0;
+        return;
+    }
+    std::size_t s = slot(hashed);
+    if (starts.empty()){
+        first = s;
+        last  = s + 1;
+    }
+    else{
+        first = starts[s];
+        last  = starts[s + 1];
+    }
+}
+
+
+inline std::size_t PerfectHash::slot (int hashed) const {
+    std::uint64_t code = codes[bucket_of(hashed)];
+    if (code & 1u){
+        return std::size_t(code >> 1);
+    }
+    return reduce(hash_mix(int(unsigned(hashed) ^ unsigned(code))), distinct);
+}
+
+
+inline bool PerfectHash::place (const std::vector<int>& values, unsigned int salt) {
+    bucket_seed = hash_mix(int(~salt));
+    codes.assign(buckets, 0);
+
+    //Group the values by bucket (first[b]..first[b+1]-1 in member), then order buckets biggest first
+    std::vector<std::size_t> first(buckets + 1, 0);
+    for (int h : values){
+        first[bucket_of(h) + 1]++;
+    }
+    std::size_t biggest = 0;
+    for (std::size_t b = 0; b < buckets; b++){
+        biggest = std::max(biggest, first[b + 1]);
+        first[b + 1] += first[b];
+    }
+    std::vector<int>         member(values.size());
+    std::vector<std::size_t> next(first.begin(), first.end() - 1);
+    for (int h : values){
+        member[next[bucket_of(h)]++] = h;
+    }
+
+    std::vector<std::size_t> by_size(biggest + 2, 0), order(buckets);
+    for (std::size_t b = 0; b < buckets; b++){
+        by_size[biggest - (first[b + 1] - first[b]) + 1]++;
+    }
+    for (std::size_t z = 0; z <= biggest; z++){
+        by_size[z + 1] += by_size[z];
+    }
+    for (std::size_t b = 0; b < buckets; b++){
+        order[by_size[biggest - (first[b + 1] - first[b])]++] = b;
+    }
+
+    std::vector<bool>        taken(distinct, false);
+    std::vector<std::size_t> slots;
+    std::size_t free = 0;
+    for (std::size_t b : order){
+        std::size_t size = first[b + 1] - first[b];
+        if (size == 0){
+            break;
+        }
+        if (size == 1){
+            while (taken[free]){
+                free++;
+            }
+            taken[free] = true;
+            codes[b] = (std::uint64_t(free) << 1) | 1u;
+            continue;
+        }
+
+        bool placed = false;
+        for (int k = 0; k < max_tries and !placed; k++){
+            unsigned int code = hash_mix(k) & ~1u;
+            slots.clear();
+            for (std::size_t j = first[b]; j < first[b + 1]; j++){
+                std::size_t s = reduce(hash_mix(int(unsigned(member[j]) ^ code)), distinct);
+                if (taken[s]){
+                    break;
+                }
+                taken[s] = true;
+                slots.push_back(s);
+            }
+            placed = (slots.size() == size);
+            if (placed){
+                codes[b] = code;
+            }
+            else{
+                for (std::size_t s : slots){
+                    taken[s] = false;
+                }
+            }
+        }
+        if (!placed){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//FrozenHashMap class and related definitions
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+FrozenHashMap<KEY,T,thash>::FrozenHashMap(const HashMap<KEY,T,thash>& to_freeze)
+: hash(to_freeze.hash_function()) {
+    std::vector<const Entry*> entries;
+    std::vector<int>          hashed;
+    entries.reserve(to_freeze.size());
+    hashed.reserve(to_freeze.size());
+    for (const Entry& m_entry : to_freeze){
+        entries.push_back(&m_entry);
+        hashed.push_back(hash(m_entry.first));
+    }
+
+    std::vector<std::size_t> order;
+    perfect = PerfectHash(hashed, order);
+    slots.reserve(entries.size());
+    for (std::size_t i : order){
+        slots.push_back(Slot{hashed[i], *entries[i]});
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool FrozenHashMap<KEY,T,thash>::empty() const {
+    return slots.empty();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t FrozenHashMap<KEY,T,thash>::size() const {
+    return slots.size();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool FrozenHashMap<KEY,T,thash>::has_key (const KEY& key) const {
+    return find_key(key) != nullptr;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool FrozenHashMap<KEY,T,thash>::has_value (const T& value) const {
+    for (const Slot& s : slots){
+        if (value == s.entry.second){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string FrozenHashMap<KEY,T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "FrozenHashMap[";
+    for (std::size_t i = 0; i < slots.size(); i++){
+        answer << std::endl << "  slot[" << i << "]: " << slots[i].entry.first << "->" << slots[i].entry.second;
+    }
+    answer << "](size=" << slots.size() << ",codes=" << perfect.codes_size() << ",starts=" << perfect.starts_size() << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+const T& FrozenHashMap<KEY,T,thash>::operator [] (const KEY& key) const {
+    const Slot* s = find_key(key);
+    if (s == nullptr){
+        std::ostringstream answer;
+        answer << "FrozenHashMap::operator []: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return s -> entry.second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool FrozenHashMap<KEY,T,thash>::operator == (const FrozenHashMap<KEY,T,thash>& rhs) const {
+    if (this == &rhs){
+        return true;
+    }
+    if (size() != rhs.size()){
+        return false;
+    }
+    for (const Slot& s : slots){
+        const Slot* other = rhs.find_key(s.entry.first);
+        if (other == nullptr or !(s.entry.second == other -> entry.second)){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool FrozenHashMap<KEY,T,thash>::operator != (const FrozenHashMap<KEY,T,thash>& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::ostream& operator << (std::ostream& outs, const FrozenHashMap<KEY,T,thash>& m) {
+    outs << "map[";
+    bool first = true;
+    for (const auto& s : m.slots){
+        outs << (first ? "" : ",") << s.entry.first << "->" << s.entry.second;
+        first = false;
+    }
+    outs << "]";
+    return outs;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto FrozenHashMap<KEY,T,thash>::find_key (const KEY& key) const -> const Slot* {
+    int hashed = hash(key);
+    std::size_t first, last;
+    perfect.positions(hashed, first, last);
+    for (; first < last; first++){
+        const Slot& s = slots[first];
+        if (s.hashed == hashed and s.entry.first == key){
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//FrozenHashSet class and related definitions
+
+template<class T, int (*thash)(const T& a)>
+FrozenHashSet<T,thash>::FrozenHashSet(const HashSet<T,thash>& to_freeze)
+: hash(to_freeze.hash_function()) {
+    std::vector<const T*> elements;
+    std::vector<int>      hashed;
+    elements.reserve(to_freeze.size());
+    hashed.reserve(to_freeze.size());
+    for (const T& e : to_freeze){
+        elements.push_back(&e);
+        hashed.push_back(hash(e));
+    }
+
+    std::vector<std::size_t> order;
+    perfect = PerfectHash(hashed, order);
+    slots.reserve(elements.size());
+    for (std::size_t i : order){
+        slots.push_back(Slot{hashed[i], *elements[i]});
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool FrozenHashSet<T,thash>::empty() const {
+    return slots.empty();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::size_t FrozenHashSet<T,thash>::size() const {
+    return slots.size();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool FrozenHashSet<T,thash>::contains (const T& element) const {
+    int hashed = hash(element);
+    std::size_t first, last;
+    perfect.positions(hashed, first, last);
+    for (; first < last; first++){
+        if (slots[first].hashed == hashed and slots[first].value == element){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::string FrozenHashSet<T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "FrozenHashSet[";
+    for (std::size_t i = 0; i < slots.size(); i++){
+        answer << std::endl << "  slot[" << i << "]: " << slots[i].value;
+    }
+    answer << "](size=" << slots.size() << ",codes=" << perfect.codes_size() << ",starts=" << perfect.starts_size() << ")";
+    return answer.str();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool FrozenHashSet<T,thash>::operator == (const FrozenHashSet<T,thash>& rhs) const {
+    if (this == &rhs){
+        return true;
+    }
+    if (size() != rhs.size()){
+        return false;
+    }
+    for (const Slot& s : slots){
+        if (!rhs.contains(s.value)){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool FrozenHashSet<T,thash>::operator != (const FrozenHashSet<T,thash>& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::ostream& operator << (std::ostream& outs, const FrozenHashSet<T,thash>& s) {
+    outs << "set[";
+    bool first = true;
+    for (const auto& slot : s.slots){
+        outs << (first ? "" : ",") << slot.value;
+        first = false;
+    }
+    outs << "]";
+    return outs;
+}
+
+}
+
+#endif /* FROZEN_HASH_MAP_HPP_ */
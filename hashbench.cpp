@@ -0,0 +1,571 @@
+//hashbench: micro-benchmarks for HashMap and HashSet, giving a baseline to compare commits against.
+//
+//Build with optimization (ics_exceptions.hpp and pair.hpp from courselib on the include path):
+//  g++ -std=c++17 -O2 -DNDEBUG -pthread -I. -I<courselib> hashbench.cpp -o hashbench
+//
+//Options (each takes one value; lists are comma-separated):
+//  --sizes     1K,10K,100K,1M  # entries (K/M/G suffixes allowed; up to 100M needs a lot of memory)
+//  --keys      int,string,struct    int, 24-char std::string, or a 64-byte struct keyed by its bytes
+//  --ops       all                  names from the list printed by --help
+//  --hit-ratio 0.5                  fraction of lookups (has_key/contains) that find their key
+//  --zipf      0.99                 exponent of the skewed (Zipfian) lookup distribution
+//  --reps      5                    repetitions of each measurement (the best and median are reported)
+//  --seed      1                    random seed (the same seed gives the same keys and lookups)
+//  --format    jsonl                jsonl (one JSON object per line) or csv (with a header line)
+//  --label     ""                   copied into every result (e.g., the commit being measured)
+//
+//Each result records label, container, key, op, size, dist (uniform or zipf), hit_ratio, ops (# timed
+//  operations per repetition), reps, and best_ns/median_ns (nanoseconds per operation).
+//Progress and errors go to std::cerr, so std::cout holds only results.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "hashmap.hpp"
+#include "hashset.hpp"
+
+
+namespace {
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Keys
+
+//A large key: 64 bytes compared (and hashed) as a whole
+class Big {
+  public:
+    std::uint64_t id;
+    char          payload[56];
+
+    bool operator == (const Big& rhs) const {return id == rhs.id and std::memcmp(payload, rhs.payload, sizeof(payload)) == 0;}
+    bool operator != (const Big& rhs) const {return !(*this == rhs);}
+};
+
+std::ostream& operator << (std::ostream& outs, const Big& b) {
+    return outs << "Big(" << b.id << ")";
+}
+
+int big_hash(const Big& b) {
+    return ics::default_hash<std::string_view>(std::string_view(reinterpret_cast<const char*>(&b), sizeof(Big)));
+}
+
+
+//A bijection on 64-bit values (splitmix64's finalizer): distinct indexes give distinct, scattered keys
+std::uint64_t scramble(std::uint64_t i) {
+    i = (i ^ (i >> 30)) * 0xbf58476d1ce4e5b9ull;
+    i = (i ^ (i >> 27)) * 0x94d049bb133111ebull;
+    return i ^ (i >> 31);
+}
+
+//make_key<K>(i) is the i-th key of type K: distinct i give distinct keys
+template<class K> K make_key(std::uint64_t i);
+
+template<> int make_key<int>(std::uint64_t i) {
+    return int(static_cast<std::uint32_t>(i * 2654435761u));   //Odd multiplier: a bijection on 32 bits
+}
+
+template<> std::string make_key<std::string>(std::uint64_t i) {
+    static const char digits[] = "0123456789abcdef";
+    std::string answer("key:");
+    for (std::uint64_t v = scramble(i), k = 0; k < 20; k++, v = (v >> 4) | (v << 60)){
+        answer += digits[v & 15];
+    }
+    return answer;
+}
+
+template<> Big make_key<Big>(std::uint64_t i) {
+    Big answer;
+    answer.id = scramble(i);
+    for (std::size_t k = 0; k < sizeof(answer.payload); k++){
+        answer.payload[k] = char(answer.id >> (8 * (k % 8)));
+    }
+    return answer;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Access patterns
+
+//Samples ranks in [1,n] with P(k) proportional to 1/k^s (s > 0), in constant time per sample and
+//  without tables, by rejection-inversion (W. Hormann and G. Derflinger, "Rejection-inversion to
+//  generate variates from monotone discrete distributions", 1996).
+class Zipf {
+  public:
+    Zipf (std::uint64_t n, double s) : n(n), s(s) {
+        h_x1 = H(1.5) - 1.0;
+        h_n  = H(double(n) + 0.5);
+        cut  = 2.0 - H_inverse(H(2.5) - h(2.0));
+    }
+
+    template<class Random>
+    std::uint64_t operator () (Random& random) const {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        for (;;){
+            double u = h_n + uniform(random) * (h_x1 - h_n);
+            double x = H_inverse(u);
+            std::uint64_t k = std::uint64_t(std::max(1.0, std::min(double(n), x + 0.5)));
+            if (double(k) - x <= cut or u >= H(double(k) + 0.5) - h(double(k))){
+                return k;
+            }
+        }
+    }
+
+  private:
+    std::uint64_t n;
+    double s, h_x1, h_n, cut;
+
+    double h (double x) const {return std::exp(-s * std::log(x));}
+    double H (double x) const {double lx = std::log(x); return expm1_over((1.0 - s) * lx) * lx;}
+    double H_inverse (double x) const {return std::exp(log1p_over(std::max(-1.0, x * (1.0 - s))) * x);}
+
+    //expm1(x)/x and log1p(x)/x, accurate near x == 0 (that is, s near 1)
+    static double expm1_over (double x) {return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x / 2.0 * (1.0 + x / 3.0 * (1.0 + x / 4.0));}
+    static double log1p_over (double x) {return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));}
+};
+
+
+//Returns ops lookup keys: each is (with probability hit_ratio) one of the n present keys, chosen
+//  uniformly or (zipf > 0) Zipfian by rank, else one of the absent keys (indexes n, n+1, ...)
+template<class K>
+std::vector<K> lookup_keys(std::size_t n, std::size_t ops, double hit_ratio, double zipf, std::uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<std::uint64_t> uniform(0, n - 1);
+    Zipf skewed(n, zipf > 0 ? zipf : 1.0);
+    std::vector<K> answer;
+    answer.reserve(ops);
+    for (std::size_t i = 0; i < ops; i++){
+        if (coin(random) < hit_ratio){
+            answer.push_back(make_key<K>(zipf > 0 ? skewed(random) - 1 : uniform(random)));
+        }
+        else{
+            answer.push_back(make_key<K>(n + uniform(random)));
+        }
+    }
+    return answer;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Measurement and output
+
+class Options {
+  public:
+    std::vector<std::size_t> sizes     = {1000, 10000, 100000, 1000000};
+    std::vector<std::string> keys      = {"int", "string", "struct"};
+    std::vector<std::string> ops       = {"all"};
+    double                   hit_ratio = 0.5;
+    double                   zipf      = 0.99;
+    int                      reps      = 5;
+    std::uint64_t            seed      = 1;
+    std::string              format    = "jsonl";
+    std::string              label;
+
+    bool wants (const std::string& op) const {
+        return std::find(ops.begin(), ops.end(), "all") != ops.end() or std::find(ops.begin(), ops.end(), op) != ops.end();
+    }
+};
+
+const char* const all_ops[] = {
+    "put", "put_presized", "put_existing", "subscript", "has_key", "has_key_zipf", "map_iterate", "map_copy", "map_erase",
+    "insert", "insert_presized", "contains", "contains_zipf", "set_iterate", "set_copy", "set_erase",
+    "set_union", "set_intersection", "set_difference", "symmetric_difference", "subset"};
+
+volatile std::size_t sink;   //Results folded here cannot be optimized away
+
+typedef std::chrono::steady_clock Clock;
+
+
+//s inside a JSON string: " and \ escaped, control characters as \u00XX
+std::string json_escape(const std::string& s) {
+    std::ostringstream answer;
+    for (char c : s){
+        if (c == '"' or c == '\\'){
+            answer << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20){
+            static const char hex[] = "0123456789abcdef";
+            answer << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+        }
+        else{
+            answer << c;
+        }
+    }
+    return answer.str();
+}
+
+
+//s as one CSV field: quoted (with each " doubled) if it holds a comma, quote, or line break
+std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos){
+        return s;
+    }
+    std::string answer = "\"";
+    for (char c : s){
+        if (c == '"'){
+            answer += '"';
+        }
+        answer += c;
+    }
+    return answer + "\"";
+}
+
+
+//Runs setup() then times run() (which performs ops operations) reps times; reports ns per operation
+template<class Setup, class Run>
+void measure(const Options& o, const char* container, const std::string& key, const char* op, std::size_t size,
+             bool lookup, bool skewed, std::size_t ops, Setup setup, Run run) {
+    std::vector<double> ns;
+    for (int r = 0; r < o.reps; r++){
+        setup();
+        Clock::time_point start = Clock::now();
+        run();
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        ns.push_back(elapsed / double(std::max<std::size_t>(ops, 1)));
+    }
+    std::sort(ns.begin(), ns.end());
+    double best = ns.front(), median = ns[ns.size() / 2];
+
+    std::ostringstream dist;
+    if (skewed){
+        dist << "zipf:" << o.zipf;
+    }
+    else{
+        dist << "uniform";
+    }
+    double hit_ratio = lookup ? o.hit_ratio : 1.0;
+
+    if (o.format == "csv"){
+        std::cout << csv_field(o.label) << ',' << container << ',' << key << ',' << op << ',' << size << ',' << dist.str() << ','
+                  << hit_ratio << ',' << ops << ',' << o.reps << ',' << best << ',' << median << std::endl;
+    }
+    else{
+        std::cout << "{\"label\":\"" << json_escape(o.label) << "\",\"container\":\"" << container << "\",\"key\":\"" << key
+                  << "\",\"op\":\"" << op << "\",\"size\":" << size << ",\"dist\":\"" << dist.str()
+                  << "\",\"hit_ratio\":" << hit_ratio << ",\"ops\":" << ops << ",\"reps\":" << o.reps
+                  << ",\"best_ns\":" << best << ",\"median_ns\":" << median << "}" << std::endl;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//The benchmarks
+
+//Lookups time at least this many operations (cycling through the lookup keys), so small tables are measured too
+constexpr std::size_t min_lookups = 1 << 20;
+
+
+template<class K, int (*khash)(const K& k)>
+void bench_map(const Options& o, const std::string& key, std::size_t n) {
+    typedef ics::HashMap<K,std::size_t,khash> Map;
+    std::vector<K> present;
+    present.reserve(n);
+    for (std::size_t i = 0; i < n; i++){
+        present.push_back(make_key<K>(i));
+    }
+    std::size_t lookups = std::max(n, min_lookups);
+
+    Map m;
+    auto fill = [&] (Map& into) {
+        for (std::size_t i = 0; i < n; i++){
+            into.put(present[i], i);
+        }
+    };
+    auto filled = [&] () {
+        if (m.size() != n){
+            m.clear();
+            fill(m);
+        }
+    };
+
+    if (o.wants("put")){
+        measure(o, "HashMap", key, "put", n, false, false, n, [&] () {m = Map();}, [&] () {fill(m);});
+    }
+    if (o.wants("put_presized")){
+        measure(o, "HashMap", key, "put_presized", n, false, false, n, [&] () {m = Map(int(std::min<std::size_t>(n, 1u << 30)));},
+                [&] () {fill(m);});
+    }
+    if (o.wants("put_existing")){
+        measure(o, "HashMap", key, "put_existing", n, false, false, n, filled, [&] () {fill(m);});
+    }
+    if (o.wants("subscript")){
+        measure(o, "HashMap", key, "subscript", n, false, false, lookups, filled, [&] () {
+            std::size_t sum = 0;
+            for (std::size_t i = 0; i < lookups; i++){
+                sum += m[present[i % n]];
+            }
+            sink = sum;
+        });
+    }
+    for (bool skewed : {false, true}){
+        if (!o.wants(skewed ? "has_key_zipf" : "has_key")){
+            continue;
+        }
+        std::vector<K> probes = lookup_keys<K>(n, lookups, o.hit_ratio, skewed ? o.zipf : 0.0, o.seed + 1);
+        measure(o, "HashMap", key, skewed ? "has_key_zipf" : "has_key", n, true, skewed, lookups, filled, [&] () {
+            std::size_t found = 0;
+            for (const K& k : probes){
+                found += m.has_key(k);
+            }
+            sink = found;
+        });
+    }
+    if (o.wants("map_iterate")){
+        measure(o, "HashMap", key, "map_iterate", n, false, false, n, filled, [&] () {
+            std::size_t sum = 0;
+            for (const auto& kv : m){
+                sum += kv.second;
+            }
+            sink = sum;
+        });
+    }
+    if (o.wants("map_copy")){
+        measure(o, "HashMap", key, "map_copy", n, false, false, n, filled, [&] () {Map copy(m); sink = copy.size();});
+    }
+    if (o.wants("map_erase")){
+        measure(o, "HashMap", key, "map_erase", n, false, false, n, filled, [&] () {
+            for (std::size_t i = 0; i < n; i++){
+                m.erase(present[i]);
+            }
+        });
+    }
+    m.clear();
+}
+
+
+template<class K, int (*khash)(const K& k)>
+void bench_set(const Options& o, const std::string& key, std::size_t n) {
+    typedef ics::HashSet<K,khash> Set;
+    std::vector<K> present;
+    present.reserve(n);
+    for (std::size_t i = 0; i < n; i++){
+        present.push_back(make_key<K>(i));
+    }
+    std::size_t lookups = std::max(n, min_lookups);
+
+    Set s;
+    auto fill = [&] (Set& into) {
+        for (const K& k : present){
+            into.insert(k);
+        }
+    };
+    auto filled = [&] () {
+        if (s.size() != n){
+            s.clear();
+            fill(s);
+        }
+    };
+
+    if (o.wants("insert")){
+        measure(o, "HashSet", key, "insert", n, false, false, n, [&] () {s = Set();}, [&] () {fill(s);});
+    }
+    if (o.wants("insert_presized")){
+        measure(o, "HashSet", key, "insert_presized", n, false, false, n, [&] () {s = Set(int(std::min<std::size_t>(n, 1u << 30)));},
+                [&] () {fill(s);});
+    }
+    for (bool skewed : {false, true}){
+        if (!o.wants(skewed ? "contains_zipf" : "contains")){
+            continue;
+        }
+        std::vector<K> probes = lookup_keys<K>(n, lookups, o.hit_ratio, skewed ? o.zipf : 0.0, o.seed + 2);
+        measure(o, "HashSet", key, skewed ? "contains_zipf" : "contains", n, true, skewed, lookups, filled, [&] () {
+            std::size_t found = 0;
+            for (const K& k : probes){
+                found += s.contains(k);
+            }
+            sink = found;
+        });
+    }
+    if (o.wants("set_iterate")){
+        measure(o, "HashSet", key, "set_iterate", n, false, false, n, filled, [&] () {
+            std::size_t count = 0;
+            for (auto i = s.begin(); i != s.end(); ++i){   //Prefix: postfix ++ copies the iterator, which would be timed too
+                count++;
+            }
+            sink = count;
+        });
+    }
+    if (o.wants("set_copy")){
+        measure(o, "HashSet", key, "set_copy", n, false, false, n, filled, [&] () {Set copy(s); sink = copy.size();});
+    }
+
+    //The set operators combine s with a set of the same size sharing half its elements; subset checks
+    //  s against their union, so it must look up every element of s
+    const char* const algebra[] = {"set_union", "set_intersection", "set_difference", "symmetric_difference", "subset"};
+    bool any = false;
+    for (const char* op : algebra){
+        any = any or o.wants(op);
+    }
+    if (any){
+        Set other;
+        for (std::size_t i = n / 2; i < n / 2 + n; i++){
+            other.insert(make_key<K>(i));
+        }
+        Set superset(other);
+        superset.insert_all(present);
+        for (const char* op : algebra){
+            if (!o.wants(op)){
+                continue;
+            }
+            std::string name(op);
+            measure(o, "HashSet", key, op, n, false, false, name == "subset" ? n : 2 * n, filled, [&] () {
+                if (name == "set_union"){
+                    sink = s.set_union(other).size();
+                }
+                else if (name == "set_intersection"){
+                    sink = s.set_intersection(other).size();
+                }
+                else if (name == "set_difference"){
+                    sink = s.set_difference(other).size();
+                }
+                else if (name == "symmetric_difference"){
+                    sink = s.symmetric_difference(other).size();
+                }
+                else{
+                    sink = (s <= superset);
+                }
+            });
+        }
+    }
+    if (o.wants("set_erase")){
+        measure(o, "HashSet", key, "set_erase", n, false, false, n, filled, [&] () {
+            for (const K& k : present){
+                s.erase(k);
+            }
+        });
+    }
+}
+
+
+template<class K, int (*khash)(const K& k)>
+void bench(const Options& o, const std::string& key) {
+    for (std::size_t n : o.sizes){
+        std::cerr << "hashbench: " << key << " keys, size " << n << std::endl;
+        bench_map<K,khash>(o, key, n);
+        bench_set<K,khash>(o, key, n);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Command line
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> answer;
+    std::istringstream in(list);
+    for (std::string item; std::getline(in, item, ',');){
+        if (!item.empty()){
+            answer.push_back(item);
+        }
+    }
+    return answer;
+}
+
+
+//Returns count (e.g., "100M") as a number; raises std::invalid_argument if it is not one
+std::size_t parse_count(const std::string& count) {
+    std::size_t digits;
+    double value = std::stod(count, &digits);
+    std::string suffix = count.substr(digits);
+    double scale = suffix == "" ? 1 : suffix == "K" or suffix == "k" ? 1e3 : suffix == "M" or suffix == "m" ? 1e6 :
+                   suffix == "G" or suffix == "g" ? 1e9 : 0;
+    if (scale == 0 or value * scale < 1){
+        throw std::invalid_argument(count);
+    }
+    return std::size_t(value * scale);
+}
+
+
+void usage() {
+    std::cerr << "usage: hashbench [--sizes 1K,1M] [--keys int,string,struct] [--ops all|op,...] [--hit-ratio 0.5]" << std::endl
+              << "                 [--zipf 0.99] [--reps 5] [--seed 1] [--format jsonl|csv] [--label text]" << std::endl
+              << "ops:";
+    for (const char* op : all_ops){
+        std::cerr << " " << op;
+    }
+    std::cerr << std::endl;
+}
+
+}
+
+
+int main(int argc, char* argv[]) {
+    Options o;
+    try{
+        for (int i = 1; i < argc; i++){
+            std::string option(argv[i]);
+            if (option == "--help"){
+                usage();
+                return 0;
+            }
+            if (i + 1 == argc){
+                throw std::invalid_argument(option + " needs a value");
+            }
+            i++;
+            std::string value(argv[i]);
+            if (option == "--sizes"){
+                o.sizes.clear();
+                for (const std::string& size : split(value)){
+                    o.sizes.push_back(parse_count(size));
+                }
+            }
+            else if (option == "--keys")      {o.keys      = split(value);}
+            else if (option == "--ops")       {o.ops       = split(value);}
+            else if (option == "--hit-ratio") {o.hit_ratio = std::stod(value);}
+            else if (option == "--zipf")      {o.zipf      = std::stod(value);}
+            else if (option == "--reps")      {o.reps      = std::stoi(value);}
+            else if (option == "--seed")      {o.seed      = std::stoull(value);}
+            else if (option == "--format")    {o.format    = value;}
+            else if (option == "--label")     {o.label     = value;}
+            else{
+                throw std::invalid_argument("unknown option " + option);
+            }
+        }
+        if (o.hit_ratio < 0 or o.hit_ratio > 1 or o.zipf <= 0 or o.reps < 1 or (o.format != "jsonl" and o.format != "csv")){
+            throw std::invalid_argument("option value out of range");
+        }
+        for (const std::string& op : o.ops){
+            if (op != "all" and std::find_if(std::begin(all_ops), std::end(all_ops), [&] (const char* a) {return op == a;}) == std::end(all_ops)){
+                throw std::invalid_argument("unknown op " + op);
+            }
+        }
+        for (const std::string& key : o.keys){
+            if (key != "int" and key != "string" and key != "struct"){
+                throw std::invalid_argument("unknown key type " + key);
+            }
+        }
+    }
+    catch (const std::exception& e){
+        std::cerr << "hashbench: " << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    if (o.format == "csv"){
+        std::cout << "label,container,key,op,size,dist,hit_ratio,ops,reps,best_ns,median_ns" << std::endl;
+    }
+    for (const std::string& key : o.keys){
+        if (key == "int"){
+            bench<int, ics::default_hash<int>>(o, key);
+        }
+        else if (key == "string"){
+            bench<std::string, ics::default_hash<std::string>>(o, key);
+        }
+        else{
+            bench<Big, big_hash>(o, key);
+        }
+    }
+    return 0;
+}
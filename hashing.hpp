@@ -0,0 +1,348 @@
+#ifndef HASHING_HPP_
+#define HASHING_HPP_
+
+#include <type_traits>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <string_view>
+
+
+namespace ics {
+
+
+//hash64<KEY>::value tells whether KEY's hash function returns a 64-bit std::uint64_t, not an int.
+//It defaults to false. Specialize it for keys so numerous (e.g., indexes of billions of keys) that
+//  32-bit hash values would collide too often, and supply a hash function returning std::uint64_t:
+//  template<> struct hash64<MyKey> : std::true_type {};
+//  std::uint64_t my_hash(const MyKey& k);      ...  HashMap<MyKey,T,my_hash> m;
+//HashMap/HashSet (and their snapshots) then keep all 64 bits through hash_mix, hash_bin, and their
+//  cached hashes, and can grow past 2^32 bins. hash_t<KEY> is the type KEY's hash function returns.
+template<class KEY>
+struct hash64 : std::false_type {};
+
+template<class KEY>
+using hash_t = typename std::conditional<hash64<KEY>::value, std::uint64_t, int>::type;
+
+
+#ifndef undefinedhashdefined
+#define undefinedhashdefined
+template<class T>
+hash_t<T> undefinedhash (const T& a) {return 0;}
+#endif /* undefinedhashdefined */
+
+
+//cache_hash<KEY>::value tells whether HashMap/HashSet store each key's full hash value in its node.
+//A cached hash means a rehash never calls the hash function again, and a lookup calls == only on
+//  nodes whose stored hash matches. It defaults to true except for scalar keys (ints, pointers...),
+//  whose hash and == are already as cheap as comparing hashes; specialize it to choose otherwise:
+//  template<> struct cache_hash<MyKey> : std::false_type {};
+template<class KEY>
+struct cache_hash : std::integral_constant<bool, !std::is_scalar<KEY>::value> {};
+
+
+//A node class derives from HashCache<cache_hash<KEY>::value,hash_t<KEY>> (Hash is the hash value type).
+//HashCache<false> is empty (so it takes no space in the node): hashed() is meaningless and
+//  may_equal is always true, so callers must not use hashed() unless cached is true.
+template<bool is_cached, class Hash = int>
+class HashCache {
+  public:
+    static constexpr bool cached = false;
+
+    void store    (Hash)         {}
+    Hash hashed   ()       const {return 0;}
+    bool may_equal(Hash)   const {return true;}
+};
+
+
+template<class Hash>
+class HashCache<true,Hash> {
+  public:
+    static constexpr bool cached = true;
+
+    void store    (Hash h)       {hash_value = h;}
+    Hash hashed   ()       const {return hash_value;}
+    bool may_equal(Hash h) const {return hash_value == h;}
+
+  private:
+    Hash hash_value = 0;
+};
+
+
+//mask_bins<KEY>::value tells whether HashMap/HashSet keep bins a power of two, compressing a hash
+//  value with hash_mix(hash) & (bins-1) instead of dividing by bins. The mix makes every bit of the
+//  hash value matter, so weak hash functions (e.g., ones that only vary in their high bits, or that
+//  produce multiples of some stride) still spread their keys over the bins. It defaults to true;
+//  specialize it to keep exactly the requested number of bins (e.g., a prime) and compress with %:
+//  template<> struct mask_bins<MyKey> : std::false_type {};
+template<class KEY>
+struct mask_bins : std::true_type {};
+
+
+//The 32-bit finalizer from MurmurHash3 (fmix32): each input bit affects every output bit
+inline unsigned int hash_mix(int hashed) {
+    unsigned int h = static_cast<unsigned int>(hashed);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+//The 64-bit finalizer from MurmurHash3 (fmix64), for 64-bit hash values (see hash64)
+inline std::uint64_t hash_mix(std::uint64_t hashed) {
+    std::uint64_t h = hashed;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+
+//Returns hashed ranged to [0,bins-1]; when masked, bins must be a power of two.
+//(Unlike abs(hashed) % bins, this is defined for every hashed, including INT_MIN.)
+//Count is the container's count type (int, or std::size_t for HashMap/HashSet).
+template<bool masked, class Count>
+inline Count hash_bin(int hashed, Count bins) {
+    if (masked){
+        return static_cast<Count>(hash_mix(hashed) & static_cast<unsigned int>(bins - 1));
+    }
+    return static_cast<Count>(static_cast<unsigned int>(hashed) % static_cast<std::uint64_t>(bins));
+}
+
+template<bool masked, class Count>
+inline Count hash_bin(std::uint64_t hashed, Count bins) {
+    if (masked){
+        return static_cast<Count>(hash_mix(hashed) & static_cast<std::uint64_t>(bins - 1));
+    }
+    return static_cast<Count>(hashed % static_cast<std::uint64_t>(bins));
+}
+
+
+//The most bins worth allocating with Count: the biggest power of two a Count holds, but with 32-bit
+//  Hash values at most 2^32 (no more bins could ever be used); 64-bit ones (see hash64) lift that cap
+template<class Count, class Hash = int>
+constexpr Count max_bins() {
+    constexpr std::uint64_t biggest = (static_cast<std::uint64_t>(std::numeric_limits<Count>::max()) >> 1) + 1;
+    constexpr std::uint64_t hashes  = (sizeof(Hash) < 8 ? std::uint64_t(1) << (8 * sizeof(Hash)) : biggest);
+    return static_cast<Count>(std::min<std::uint64_t>(biggest, hashes));
+}
+
+
+//Returns the number of bins to allocate when requested bins are wanted: at least 1, at most
+//  max_bins<Count,Hash>(), and when masked, the smallest power of two >= requested
+template<bool masked, class Count, class Hash = int>
+inline Count bin_count(Count requested) {
+    if (requested <= 1){
+        return 1;
+    }
+    if (requested >= max_bins<Count,Hash>()){
+        return max_bins<Count,Hash>();
+    }
+    if (!masked){
+        return requested;
+    }
+    Count bins = 1;
+    while (bins < requested){
+        bins <<= 1;
+    }
+    return bins;
+}
+
+
+//HashFunction<KEY,thash> is a container's hash function: thash when it is supplied as a template
+//  argument, otherwise the chash supplied to a constructor (so it is stored as a pointer either way,
+//  and compares/assigns/converts like one). Calling it calls a template-argument thash directly, not
+//  through the pointer, so the compiler can inline it into the lookup; only a chash is called indirectly.
+template<class KEY, hash_t<KEY> (*thash)(const KEY& a)>
+class HashFunction {
+    //Whether thash was supplied (compared as template arguments: some compilers do not treat
+    //  comparing a function template's address with a constant as a constant expression)
+    template<hash_t<KEY> (*f)(const KEY& a)> class Tag {};
+    static constexpr bool supplied = !std::is_same<Tag<thash>, Tag<nullptr>>::value and
+                                     !std::is_same<Tag<thash>, Tag<undefinedhash<KEY>>>::value;
+
+  public:
+    typedef hash_t<KEY> (*hashfunc) (const KEY& a);
+
+    HashFunction (hashfunc f = nullptr) : f(f) {}
+    operator hashfunc () const {return f;}
+
+    hash_t<KEY> operator () (const KEY& key) const {
+        if constexpr (supplied){
+            return thash(key);
+        }
+        else{
+            return f(key);
+        }
+    }
+
+  private:
+    hashfunc f;
+};
+
+
+//default_hash<KEY> is a hash function for integral/enum keys and for std::string/std::string_view
+//  keys, meant as a template argument (e.g., HashMap<int,T,default_hash<int>>) so that it inlines.
+//Integers hash to themselves (folding wider ones to 32 bits): hash_bin mixes the bits anyway.
+//Strings use FNV-1a; std::string and std::string_view hash equally (for transparent lookup).
+template<class KEY>
+int default_hash(const KEY& key) {
+    static_assert(std::is_integral<KEY>::value or std::is_enum<KEY>::value,
+                  "default_hash: no default hash function for this KEY type: supply one");
+    if constexpr (sizeof(KEY) <= sizeof(int)){
+        return static_cast<int>(key);
+    }
+    else{
+        unsigned long long k = static_cast<unsigned long long>(key);
+        return static_cast<int>(static_cast<unsigned int>(k ^ (k >> 32)));
+    }
+}
+
+template<>
+inline int default_hash<std::string_view>(const std::string_view& key) {
+    unsigned int h = 2166136261u;
+    for (char c : key){
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return static_cast<int>(h);
+}
+
+template<>
+inline int default_hash<std::string>(const std::string& key) {
+    return default_hash<std::string_view>(key);
+}
+
+
+//default_hash64<KEY> is the same for keys whose hash64 is true: integers hash to themselves (all 64
+//  bits), and strings use the 64-bit FNV-1a.
+template<class KEY>
+std::uint64_t default_hash64(const KEY& key) {
+    static_assert(std::is_integral<KEY>::value or std::is_enum<KEY>::value,
+                  "default_hash64: no default hash function for this KEY type: supply one");
+    return static_cast<std::uint64_t>(key);
+}
+
+template<>
+inline std::uint64_t default_hash64<std::string_view>(const std::string_view& key) {
+    std::uint64_t h = 14695981039346656037ull;
+    for (char c : key){
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return h;
+}
+
+template<>
+inline std::uint64_t default_hash64<std::string>(const std::string& key) {
+    return default_hash64<std::string_view>(key);
+}
+
+
+//Starts loading the cache line holding p, without waiting for it (a hint: it never faults, even for
+//  nullptr). Batched lookups prefetch many bins/nodes before using any of them, so their cache misses overlap.
+inline void prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#endif
+}
+
+
+//Returns the index of the lowest 1 bit in word (which must not be 0)
+inline int lowest_bit(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int i = 0;
+    while ((word & 1) == 0){
+        word >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+
+//OccupancyBits records which bins of a chained table are nonempty (1 bit per bin), so iterating
+//  skips 64 empty bins per word (with lowest_bit) instead of loading each bin: a big, sparse table
+//  (e.g., after mass erasure) is scanned in time proportional to its nonempty bins.
+//Up to 64 bins use one word inside the object, so small tables allocate nothing.
+class OccupancyBits {
+  public:
+    OccupancyBits  () {}
+    ~OccupancyBits () {release();}
+    OccupancyBits  (const OccupancyBits& to_copy)              = delete;
+    OccupancyBits& operator = (const OccupancyBits& rhs)       = delete;
+
+    void reset (std::size_t bins);    //Make bins bins, all empty
+    void set   (std::size_t bin)         {words[bin >> 6] |=  (std::uint64_t(1) << (bin & 63));}
+    void clear (std::size_t bin)         {words[bin >> 6] &= ~(std::uint64_t(1) << (bin & 63));}
+    std::size_t next (std::size_t bin, std::size_t bins) const;  //Lowest nonempty bin >= bin; bins if none
+
+    //Word access, for rebuilding the bits in parallel: word w holds the bits of bins [64*w,64*w+63]
+    std::size_t    word_count ()              const {return count;}
+    std::uint64_t& word       (std::size_t w)       {return words[w];}
+
+    void swap  (OccupancyBits& other);
+
+  private:
+    std::uint64_t  one   = 0;      //The only word, for up to 64 bins
+    std::uint64_t* words = &one;
+    std::size_t    count = 1;      //# words
+
+    void release () {
+        if (words != &one){
+            delete[] words;
+        }
+    }
+};
+
+
+inline void OccupancyBits::reset(std::size_t bins) {
+    std::size_t new_count = (bins + 63) / 64;
+    if (new_count != count){
+        std::uint64_t* new_words = (new_count <= 1 ? &one : new std::uint64_t[new_count]);
+        release();
+        words = new_words;
+        count = std::max<std::size_t>(1, new_count);
+    }
+    std::fill(words, words + count, 0);
+}
+
+
+inline std::size_t OccupancyBits::next(std::size_t bin, std::size_t bins) const {
+    if (bin >= bins){
+        return bins;
+    }
+    std::size_t   w    = bin >> 6;
+    std::uint64_t bits = words[w] & (~std::uint64_t(0) << (bin & 63));
+    while (bits == 0){
+        if (++w >= count){
+            return bins;
+        }
+        bits = words[w];
+    }
+    return (w << 6) + lowest_bit(bits);
+}
+
+
+inline void OccupancyBits::swap(OccupancyBits& other) {
+    std::swap(one,   other.one);
+    std::swap(words, other.words);
+    std::swap(count, other.count);
+    if (words == &other.one){
+        words = &one;
+    }
+    if (other.words == &one){
+        other.words = &other.one;
+    }
+}
+
+}
+
+#endif /* HASHING_HPP_ */
@@ -9,8 +9,20 @@
 #include <iostream>
 #include <sstream>
 #include <initializer_list>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
 #include "ics_exceptions.hpp"
 #include "pair.hpp"
+#include "nodepool.hpp"
+#include "hashing.hpp"
+#include "parallel.hpp"
+#include "hashsnapshot.hpp"
+#include "hashstats.hpp"
 
 
 namespace ics {
@@ -19,59 +31,134 @@ namespace ics {
 #ifndef undefinedhashdefined
 #define undefinedhashdefined
 template<class T>
-int undefinedhash (const T& a) {return 0;}
+hash_t<T> undefinedhash (const T& a) {return 0;}
 #endif /* undefinedhashdefined */
 
-//Instantiate the templated class supplying thash(a): produces a hash value for a.
+//Instantiate the templated class supplying thash(a): produces a hash value for a (an int, or a
+//  std::uint64_t when hash64 is specialized true for the key type: see hashing.hpp).
 //If thash is defaulted to undefinedhash in the template, then a constructor must supply chash.
 //If both thash and chash are supplied, then they must be the same (by ==) function.
 //If neither is supplied, or both are supplied but different, TemplateFunctionError is raised.
 //The (unique) non-undefinedhash value supplied by thash/chash is stored in the instance variable hash.
-template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class HashMap {
+//Small mode: while it holds at most SMALL (up to 8) keys, an instance allocates nothing: its 1 bin
+//  and first nodes are inside the object. So swap and moving the object (not its keys) relocate
+//  those nodes: references into a small instance do not survive them.
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a) = nullptr> class HashMap {
   public:
     typedef ics::pair<KEY,T>   Entry;
-    typedef int (*hashfunc) (const KEY& a);
+    typedef hash_t<KEY> (*hashfunc) (const KEY& a);
 
     //Destructor/Constructors
     ~HashMap ();
 
-    HashMap          (double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
-    explicit HashMap (int initial_bins, double the_load_threshold = 1.0, int (*chash)(const KEY& k) = nullptr);
-    HashMap          (const HashMap<KEY,T,thash>& to_copy, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
-    explicit HashMap (const std::initializer_list<Entry>& il, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+    HashMap          (double the_load_threshold = 1.0, hash_t<KEY> (*chash)(const KEY& a) = nullptr);
+    explicit HashMap (int initial_bins, double the_load_threshold = 1.0, hash_t<KEY> (*chash)(const KEY& k) = nullptr);
+    HashMap          (const HashMap<KEY,T,thash>& to_copy, double the_load_threshold = 1.0, hash_t<KEY> (*chash)(const KEY& a) = nullptr);
+    HashMap          (HashMap<KEY,T,thash>&& to_move);  //to_move is left empty (with 1 bin)
+    explicit HashMap (const std::initializer_list<Entry>& il, double the_load_threshold = 1.0, hash_t<KEY> (*chash)(const KEY& a) = nullptr);
 
     //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
     template <class Iterable>
-    explicit HashMap (const Iterable& i, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+    explicit HashMap (const Iterable& i, double the_load_threshold = 1.0, hash_t<KEY> (*chash)(const KEY& a) = nullptr);
 
 
     //Queries
     bool empty      () const;
-    int  size       () const;
+    std::size_t size () const;
     bool has_key    (const KEY& key) const;
     bool has_value  (const T& value) const;
     std::string str () const; //supplies useful debugging information; contrast to operator <<
+    hashfunc    hash_function () const; //The hash function in use (thash or chash)
+
+    //Pointer to key's value, or nullptr if key is not in the map: one lookup, where has_key and then
+    //  operator [] are two. The pointer is invalidated like an iterator.
+    T*       find (const KEY& key);
+    const T* find (const KEY& key) const;
+
+    //Transparent lookup: key need not be a KEY (e.g., std::string_view for std::string keys), so no
+    //  temporary KEY is built. KEY2 == KEY must be defined, and hash2(key) must equal hash(k) for every
+    //  KEY k == key. get is like operator [] except that it never puts: it raises KeyError instead.
+    template <class KEY2>
+    bool     has_key (const KEY2& key, hash_t<KEY> (*hash2)(const KEY2& k)) const;
+    template <class KEY2>
+    T&       get     (const KEY2& key, hash_t<KEY> (*hash2)(const KEY2& k));
+    template <class KEY2>
+    const T& get     (const KEY2& key, hash_t<KEY> (*hash2)(const KEY2& k)) const;
+
+    //Batched lookup of keys[0..n-1]: found[i] = has_key(keys[i]); get_batch also copies each found
+    //  key's value into values[i] (leaving values[i] unchanged for an absent key; found may be nullptr).
+    //  Both return the # of keys found. The keys are hashed and their bins/first nodes prefetched in
+    //  groups, so the cache misses of a group's lookups overlap instead of happening one after another.
+    std::size_t has_keys  (const KEY* keys, std::size_t n, bool* found) const;
+    std::size_t get_batch (const KEY* keys, std::size_t n, T* values, bool* found = nullptr) const;
+
+    //The table's shape and (with ICS_HASH_STATS) its lookup/resize activity: see hashstats.hpp
+    HashStats stats () const;
 
 
     //Commands
+    //put returns key's old value (moved out of the map), or a copy of value if key was new (the
+    //  rvalue put moves value into the map and copies it from there); insert_or_assign copies nothing
     T    put   (const KEY& key, const T& value);
+    T    put   (KEY&& key, T&& value);
     T    erase (const KEY& key);
     void clear ();
+    void swap  (HashMap<KEY,T,thash>& other);
+
+    //Like put, but without constructing a copy of the old value to return: true iff key was new
+    bool insert_or_assign (const KEY& key, const T& value);
+    bool insert_or_assign (KEY&& key, T&& value);
+
+    //emplace constructs an Entry from args, and puts it only if its key is new;
+    //  try_emplace constructs the value from args only if key is new. Both return true iff they put.
+    template <class... Args>
+    bool emplace     (Args&&... args);
+    template <class... Args>
+    bool try_emplace (const KEY& key, Args&&... args);
+    template <class... Args>
+    bool try_emplace (KEY&& key, Args&&... args);
+
+    //Returns key's value; if key is absent first puts it with value compute(key). Either way key is
+    //  hashed and its bin searched once (compute is called only for an absent key).
+    template <class Compute>
+    T& compute_if_absent (const KEY& key, Compute compute);
+
+    //Growing/shrinking to keep used/bins near load_threshold normally moves every node at once.
+    //  With bins_per_step > 0 it is incremental instead: the old bins are kept alongside the new ones
+    //  and each later put/erase/operator[] insertion migrates bins_per_step of them, or more when
+    //  needed to finish before the next resize could start (a small multiple of 1/load_threshold),
+    //  so no single mutation ever migrates a whole table.
+    void set_incremental_rehash(int bins_per_step);
+
+    //Zeroes the activity counters reported by stats()
+    void reset_stats ();
 
     //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    //With enough entries (see parallel.hpp) the entries are hashed, partitioned by bin, and linked in
+    //  on several threads; the result is the same as putting them one at a time (a later entry's value
+    //  replaces an earlier one's), but hash and KEY ==/copying must be thread-safe.
     template <class Iterable>
-    int put_all(const Iterable& i);
+    std::size_t put_all(const Iterable& i);
+
+    //Binary snapshots (see hashsnapshot.hpp); KEY and T must be trivially copyable.
+    //save writes every key->value to file_name; load replaces this map's contents by those saved in
+    //  file_name, raising FileOpenError unless it is a snapshot of a map with these KEY/T types (saved
+    //  with this hash function). MappedHashMap (mappedhashmap.hpp) serves lookups from such a file in place.
+    void save (const std::string& file_name) const;
+    void load (const std::string& file_name);
 
 
     //Operators
 
     T&       operator [] (const KEY&);
+    T&       operator [] (KEY&&);
     const T& operator [] (const KEY&) const;
     HashMap<KEY,T,thash>& operator = (const HashMap<KEY,T,thash>& rhs);
+    HashMap<KEY,T,thash>& operator = (HashMap<KEY,T,thash>&& rhs);
     bool operator == (const HashMap<KEY,T,thash>& rhs) const;
     bool operator != (const HashMap<KEY,T,thash>& rhs) const;
 
-    template<class KEY2,class T2, int (*hash2)(const KEY2& a)>
+    template<class KEY2,class T2, hash_t<KEY2> (*hash2)(const KEY2& a)>
     friend std::ostream& operator << (std::ostream& outs, const HashMap<KEY2,T2,hash2>& m);
 
 
@@ -82,7 +169,7 @@ template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class HashMap
   public:
     class Iterator {
       public:
-         typedef pair<int,LN*> Cursor;
+         typedef pair<std::ptrdiff_t,LN*> Cursor;
 
         //Private constructor called in begin/end, which are friends of HashMap<T>
         ~Iterator();
@@ -121,32 +208,89 @@ template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class HashMap
 
 
   private:
-    class LN {
+    //Unless cache_hash<KEY> is false, each LN also stores hash(value.first) (see hashing.hpp)
+    class LN : public HashCache<cache_hash<KEY>::value,hash_t<KEY>> {
     public:
       LN ()                         : next(nullptr){}
-      LN (const LN& ln)             : value(ln.value), next(ln.next){}
+      LN (const LN& ln)             : HashCache<cache_hash<KEY>::value,hash_t<KEY>>(ln), value(ln.value), next(ln.next){}
+      LN (const LN& ln, LN* n)      : HashCache<cache_hash<KEY>::value,hash_t<KEY>>(ln), value(ln.value), next(n){}
       LN (Entry v, LN* n = nullptr) : value(v), next(n){}
 
+      //Assign the members so that rvalue keys/values are moved into the node, not copied
+      template <class K, class V>
+      LN (K&& k, V&& v, LN* n) : next(n){
+        value.first  = std::forward<K>(k);
+        value.second = std::forward<V>(v);
+      }
+
       Entry value;
       LN*   next;
   };
 
-  int (*hash)(const KEY& k);  //Hashing function used (from template or constructor)
-  LN** map      = nullptr;    //Pointer to array of pointers: each bin stores a list with a trailer node
+  HashFunction<KEY,thash> hash; //Hashing function used (from template or constructor)
+  LN** map      = nullptr;    //Pointer to array of pointers: each bin stores a nullptr-terminated list (empty bins allocate nothing)
   double load_threshold;      //used/bins <= load_threshold
-  int bins      = 1;          //# bins in array (should start >= 1 so hash_compress doesn't % 0)
-  int used      = 0;          //Cache for number of key->value pairs in the hash table
+  std::size_t bins     = 1;   //# bins in array: >= 1, and a power of two when masked (see bin_count)
+  std::size_t min_bins = 1;   //Never shrink below this # of bins (the initial_bins requested)
+  std::size_t used     = 0;   //Cache for number of key->value pairs in the hash table (in map and old_map)
   int mod_count = 0;          //For sensing concurrent modification
 
+  OccupancyBits occupied;     //Which bins of map are nonempty (so iterating skips runs of empty bins)
+
+  LN** old_map     = nullptr; //During an incremental rehash, the bins still being migrated into map
+  std::size_t old_bins = 0;   //# bins in old_map
+  std::size_t migrated = 0;   //old_map[0..migrated-1] are empty
+  int  rehash_step = 0;       //# old bins migrated per mutation; 0 means rehash all at once
+  std::size_t rehash_pace = 0; //# old bins the current rehash migrates per mutation (>= rehash_step; see start_rehash)
+
+  mutable NodePool<LN> pool;  //Allocates every LN in map and old_map not in small_nodes (copy_list is const)
+  HashCounters counters;      //Lookup/resize activity for stats (counted only with ICS_HASH_STATS)
+
+  //Small mode: a map of at most SMALL keys keeps 1 bin (searched linearly) and its nodes inside the
+  //  object, so the many tiny maps a program may create and destroy allocate nothing at all
+  static constexpr int SMALL = inline_node_count<LN>(8);
+  LN* small_bin = nullptr;                    //map (or old_map) when it has 1 bin (see allocate_bins)
+  mutable InlineNodes<LN,SMALL> small_nodes;  //The first nodes made (see make_node)
+
+  static constexpr int BATCH = 16;  //# keys find_batch prefetches before resolving any of them
+
+
+  static constexpr bool masked = mask_bins<KEY>::value;     //bins is a power of two; hash_compress masks
 
   //Helper methods
-  int   hash_compress        (const KEY& key)          const;  //hash function ranged to [0,bins-1]
+  std::size_t hash_compress  (hash_t<KEY> hashed, std::size_t bins) const;  //hash value ranged to [0,bins-1]
+  std::size_t bins_for       (std::size_t count)        const;  //# bins (see bin_count) that count keys need at load_threshold
+  hash_t<KEY> node_hash      (const LN* node)          const;  //hash(node's key), from the node if it caches it
   LN*   find_key             (const KEY& key) const;           //Returns reference to key's node or nullptr
+  template <class KEY2>
+  LN*   find_key             (const KEY2& key, hash_t<KEY> hashed) const;  //Same, given hashed == hash(key)
+  LN**  find_link            (const KEY& key);                 //Returns the pointer (bin or next) to key's node or nullptr
+  template <class Found>
+  void  find_batch           (const KEY* keys, std::size_t n, Found found) const;  //Calls found(i, find_key(keys[i])) for each i
+
+  template <class K, class V>
+  LN*   link_new             (K&& key, V&& value, hash_t<KEY> hashed); //Put a node for absent key (growing first); returns it
+  template <class K, class V>
+  bool  assign               (K&& key, V&& value);             //Implements insert_or_assign
+  template <class... Args>
+  LN*   make_node            (Args&&... args)          const;  //Construct a node in small_nodes if it has room, else in pool
+  void  recycle_node         (LN* node);                       //Destroy node and reuse its memory
+  void  destroy_node         (LN* node);                       //Destroy node without reusing its memory (before pool.release_all)
+  void  evict_small_nodes    (InlineNodes<LN,SMALL>* into = nullptr); //Move any nodes in small_nodes into into's (empty) slots, else pool nodes
+  LN**  allocate_bins        (std::size_t count);              //Zeroed array of count bins: &small_bin when count == 1
+  void  free_bins            (LN** ht);                        //Deallocate an array from allocate_bins
+  void  mark_occupied        (int workers = 1);                //Recompute occupied from map (on workers threads)
+  void  unlinked             (LN** link);                      //After unlinking the node at link, clear its bin's bit if now empty
   LN*   copy_list            (LN*   l)                 const;  //Copy the keys/values in a bin (order irrelevant)
-  LN**  copy_hash_table      (LN** ht, int bins)       const;  //Copy the bins/keys/values in ht tree (order in bins irrelevant)
+  LN**  copy_hash_table      (LN** ht, std::size_t bins);  //Copy the bins/keys/values in ht tree (order in bins irrelevant)
+  void  destroy_hash_table   (LN**& ht, std::size_t bins);       //Like delete_hash_table, but leaves the memory to pool.release_all
 
-  void  ensure_load_threshold(int new_used);                   //Reallocate if load_factor > load_threshold
-  void  delete_hash_table    (LN**& ht, int bins);             //Deallocate all LN in ht (and the ht itself; ht == nullptr)
+  void  ensure_load_threshold(std::size_t new_used);           //Reallocate if load_factor > load_threshold (or far below it)
+  void  start_rehash         (std::size_t new_bins);           //Replace map by new_bins empty bins, moving (some) nodes into it
+  void  migrate_bins         (std::size_t count);              //Move the nodes in the next count old bins into map
+  void  delete_hash_table    (LN**& ht, std::size_t bins);        //Deallocate all LN in ht (and the ht itself; ht == nullptr)
+
+  void  bulk_put             (const std::vector<const Entry*>& entries, int workers);  //put_all on workers threads
 };
 
 
@@ -158,14 +302,17 @@ template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class HashMap
 //HashMap class and related definitions
 
 //Destructor/Constructors
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 HashMap<KEY,T,thash>::~HashMap() {
-    delete_hash_table(map, bins);
+    destroy_hash_table(map, bins);
+    if (old_map != nullptr){
+        destroy_hash_table(old_map, old_bins);
+    }
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-HashMap<KEY,T,thash>::HashMap(double the_load_threshold, int (*chash)(const KEY& k))
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+HashMap<KEY,T,thash>::HashMap(double the_load_threshold, hash_t<KEY> (*chash)(const KEY& k))
 :   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
     if (hash == nullptr){
         throw TemplateFunctionError("HashMap::default constructor: neither specified");
@@ -173,34 +320,29 @@ HashMap<KEY,T,thash>::HashMap(double the_load_threshold, int (*chash)(const KEY&
     if(thash != nullptr and chash != nullptr and thash != chash){
         throw TemplateFunctionError("HashMap::default constructor: both specified and different");
     }
-    map = new LN* [bins];
-    for (int i = 0; i < bins; i++){
-        map[i] = new LN();
-    }
+    map = allocate_bins(bins);
+    occupied.reset(bins);
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-HashMap<KEY,T,thash>::HashMap(int initial_bins, double the_load_threshold, int (*chash)(const KEY& k))
-:   hash(thash != nullptr ? thash : chash), bins (initial_bins), load_threshold(the_load_threshold){
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+HashMap<KEY,T,thash>::HashMap(int initial_bins, double the_load_threshold, hash_t<KEY> (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
     if (hash == nullptr){
         throw TemplateFunctionError("HashMap::length constructor: neither specified");
     }
     if (thash != nullptr and chash != nullptr and thash != chash){
         throw TemplateFunctionError("HashMap::length constructor: both specified and different");
     }
-    if (bins <= 0){
-        bins = 1;
-    }
-    map = new LN* [bins];
-    for (int i = 0; i < bins; i ++){
-        map[i] = new LN();
-    }
+    bins = bin_count<masked, std::size_t, hash_t<KEY>>(std::size_t(std::max(1, initial_bins)));
+    min_bins = bins;
+    map = allocate_bins(bins);
+    occupied.reset(bins);
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-HashMap<KEY,T,thash>::HashMap(const HashMap<KEY,T,thash>& to_copy, double the_load_threshold, int (*chash)(const KEY& a))
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+HashMap<KEY,T,thash>::HashMap(const HashMap<KEY,T,thash>& to_copy, double the_load_threshold, hash_t<KEY> (*chash)(const KEY& a))
 :   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(to_copy.bins)
 {
     if (hash == nullptr){
@@ -209,30 +351,43 @@ HashMap<KEY,T,thash>::HashMap(const HashMap<KEY,T,thash>& to_copy, double the_lo
     if (thash != nullptr and chash != nullptr and thash != chash){
         throw TemplateFunctionError("HashMap::copy constructor: both specified and different");
     }
+    rehash_step = to_copy.rehash_step;
     if (hash == to_copy.hash){
         used = to_copy.used;
+        min_bins = to_copy.min_bins;
         map = copy_hash_table(to_copy.map, to_copy.bins);
+        mark_occupied();
+        if (to_copy.old_map != nullptr){
+            old_bins = to_copy.old_bins;
+            migrated = to_copy.migrated;
+            old_map  = copy_hash_table(to_copy.old_map, to_copy.old_bins);
+            rehash_pace = to_copy.rehash_pace;
+        }
     }
     else{
-        bins = int(to_copy.size());
-        map = new LN* [bins];
-        for (int i = 0; i < bins; i++){
-            map[i] = new LN();
-        }
-        for (int i = 0; i < to_copy.bins; i++){
-            LN* temp = to_copy.map[i];
-            while (temp -> next != nullptr){
-                put (temp -> value.first, temp -> value.second);
-                temp = temp -> next;
-            }
+        bins = bins_for(to_copy.size());
+        map = allocate_bins(bins);
+        occupied.reset(bins);
+        for (const Entry& m_entry : to_copy){
+            put (m_entry.first, m_entry.second);
         }
     }
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-HashMap<KEY,T,thash>::HashMap(const std::initializer_list<Entry>& il, double the_load_threshold, int (*chash)(const KEY& k))
-:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(il.size())
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+HashMap<KEY,T,thash>::HashMap(HashMap<KEY,T,thash>&& to_move)
+:   hash(to_move.hash), load_threshold(to_move.load_threshold)
+{
+    map = allocate_bins(bins);
+    occupied.reset(bins);
+    swap(to_move);
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+HashMap<KEY,T,thash>::HashMap(const std::initializer_list<Entry>& il, double the_load_threshold, hash_t<KEY> (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold)
 {
     if (hash == nullptr){
         throw TemplateFunctionError("HashMap::initializer_list constructor : neither specified");
@@ -240,20 +395,17 @@ HashMap<KEY,T,thash>::HashMap(const std::initializer_list<Entry>& il, double the
     if (thash != nullptr and chash != nullptr and thash != chash){
         throw TemplateFunctionError("HashMap::initializer_list constructor: both specified and different");
     }
-    map = new LN* [bins];
-    for (int i = 0; i < bins; i ++){
-        map[i] = new LN();
-    }
-    for (const Entry& m_entry : il){
-        put(m_entry.first, m_entry.second);
-    }
+    bins = bins_for(il.size());
+    map = allocate_bins(bins);
+    occupied.reset(bins);
+    put_all(il);
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 template <class Iterable>
-HashMap<KEY,T,thash>::HashMap(const Iterable& i, double the_load_threshold, int (*chash)(const KEY& k))
-:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(i.size())
+HashMap<KEY,T,thash>::HashMap(const Iterable& i, double the_load_threshold, hash_t<KEY> (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold)
 {
     if (hash == nullptr){
         throw TemplateFunctionError("HashMap::Iterable constructor: neither specified");
@@ -261,93 +413,219 @@ HashMap<KEY,T,thash>::HashMap(const Iterable& i, double the_load_threshold, int
     if (thash != nullptr and chash != nullptr and thash != chash){
         throw TemplateFunctionError("HashMap::Iterable constructor: both specified and different");
     }
-    map = new LN* [bins];
-    for (int i = 0; i < bins; i++){
-        map[i] = new LN();
-    }
-    for (const Entry& m_entry: i){
-        put(m_entry.first, m_entry.second);
-    }
+    bins = bins_for(i.size());
+    map = allocate_bins(bins);
+    occupied.reset(bins);
+    put_all(i);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 //Queries
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 bool HashMap<KEY,T,thash>::empty() const {
     return used == 0;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-int HashMap<KEY,T,thash>::size() const {
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::size_t HashMap<KEY,T,thash>::size() const {
     return used;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 bool HashMap<KEY,T,thash>::has_key (const KEY& key) const {
     return find_key(key) != nullptr;
 }
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class KEY2>
+bool HashMap<KEY,T,thash>::has_key (const KEY2& key, hash_t<KEY> (*hash2)(const KEY2& k)) const {
+    return find_key(key, hash2(key)) != nullptr;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+T* HashMap<KEY,T,thash>::find (const KEY& key) {
+    LN* temp = find_key(key);
+    return temp == nullptr ? nullptr : &temp -> value.second;
+}
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+const T* HashMap<KEY,T,thash>::find (const KEY& key) const {
+    LN* temp = find_key(key);
+    return temp == nullptr ? nullptr : &temp -> value.second;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class KEY2>
+T& HashMap<KEY,T,thash>::get (const KEY2& key, hash_t<KEY> (*hash2)(const KEY2& k)) {
+    LN* temp = find_key(key, hash2(key));
+    if (temp == nullptr){
+        std::ostringstream answer;
+        answer << "HashMap::get: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return temp -> value.second;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class KEY2>
+const T& HashMap<KEY,T,thash>::get (const KEY2& key, hash_t<KEY> (*hash2)(const KEY2& k)) const {
+    LN* temp = find_key(key, hash2(key));
+    if (temp == nullptr){
+        std::ostringstream answer;
+        answer << "HashMap::get: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return temp -> value.second;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 bool HashMap<KEY,T,thash>::has_value (const T& value) const {
-    for (int i = 0; i < bins; i++){
-        LN* temp = map[i];
-        while (temp -> next != nullptr){
-            if (value == temp -> value.second){
-                return true;
-            }
-            temp = temp -> next;
+    for (const Entry& m_entry : *this){
+        if (value == m_entry.second){
+            return true;
         }
     }
     return false;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+auto HashMap<KEY,T,thash>::hash_function() const -> hashfunc {
+    return hash;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 std::string HashMap<KEY,T,thash>::str() const {
-    std::string x;
-    return x;
-};
+    std::ostringstream answer;
+    answer << "HashMap[";
+    for (std::size_t i = 0; i < bins; i++){
+        answer << std::endl << "  bin[" << i << "]: ";
+        for (LN* temp = map[i]; temp != nullptr; temp = temp -> next){
+            answer << temp -> value.first << "->" << temp -> value.second << " ";
+        }
+    }
+    for (std::size_t i = migrated; i < old_bins; i++){
+        answer << std::endl << "  old bin[" << i << "]: ";
+        for (LN* temp = old_map[i]; temp != nullptr; temp = temp -> next){
+            answer << temp -> value.first << "->" << temp -> value.second << " ";
+        }
+    }
+    answer << "](used=" << used << ",bins=" << bins << ",old_bins=" << old_bins << ",mod_count=" << mod_count << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+HashStats HashMap<KEY,T,thash>::stats() const {
+    HashStats answer;
+    for (std::size_t i = 0; i < bins; i++){
+        std::size_t length = 0;
+        for (LN* temp = map[i]; temp != nullptr; temp = temp -> next){
+            length++;
+        }
+        count_chain(answer, length);
+    }
+    for (std::size_t i = migrated; i < old_bins; i++){
+        std::size_t length = 0;
+        for (LN* temp = old_map[i]; temp != nullptr; temp = temp -> next){
+            length++;
+        }
+        count_chain(answer, length);
+    }
+    answer.size        = used;
+    answer.load_factor = double(used) / double(answer.bins);
+    counters.fill(answer);
+    return answer;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::size_t HashMap<KEY,T,thash>::has_keys (const KEY* keys, std::size_t n, bool* found) const {
+    std::size_t count = 0;
+    find_batch(keys, n, [&] (std::size_t i, LN* node) {
+        found[i] = (node != nullptr);
+        count += found[i];
+    });
+    return count;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::size_t HashMap<KEY,T,thash>::get_batch (const KEY* keys, std::size_t n, T* values, bool* found) const {
+    std::size_t count = 0;
+    find_batch(keys, n, [&] (std::size_t i, LN* node) {
+        if (node != nullptr){
+            values[i] = node -> value.second;
+            count++;
+        }
+        if (found != nullptr){
+            found[i] = (node != nullptr);
+        }
+    });
+    return count;
+}
 
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 //Commands
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 T HashMap<KEY,T,thash>::put(const KEY& key, const T& value) {
-    LN* temp = find_key(key);
-    T xd;
+    migrate_bins(rehash_pace);
+    hash_t<KEY> hashed = hash(key);
+    LN* temp = find_key(key, hashed);
     mod_count++;
     if (temp == nullptr){
-        xd = value;
-        used++;
-        map[hash_compress(key)] = new LN(Entry(key, value), map[hash_compress(key)]);
-    }
-    else{
-        xd = temp -> value.second;
-        temp -> value.second = value;
+        link_new(key, value, hashed);
+        return value;
     }
 
+    //Copy value before swapping it in: value may be (a reference to) the old value itself
+    T xd = value;
+    std::swap(xd, temp -> value.second);
+    return xd;
+}
+
 
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+T HashMap<KEY,T,thash>::put(KEY&& key, T&& value) {
+    migrate_bins(rehash_pace);
+    hash_t<KEY> hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    mod_count++;
+    if (temp == nullptr){
+        return link_new(std::move(key), std::move(value), hashed) -> value.second;
+    }
+    T xd = std::move(temp -> value.second);
+    temp -> value.second = std::move(value);
     return xd;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 T HashMap<KEY,T,thash>::erase(const KEY& key) {
-    LN* temp = find_key(key);
-
-    if (temp != nullptr) {
-        T xd = temp->value.second;
-        LN *to_delete = temp->next;
-        *temp = *temp->next;
-        delete to_delete;
+    LN** link = find_link(key);
+
+    if (link != nullptr) {
+        LN *to_delete = *link;
+        T xd = std::move(to_delete->value.second);
+        *link = to_delete->next;
+        unlinked(link);
+        recycle_node(to_delete);
         used--;
         mod_count++;
+        migrate_bins(rehash_pace);
+        ensure_load_threshold(used);
         return xd;
     }
     else {
@@ -358,55 +636,254 @@ T HashMap<KEY,T,thash>::erase(const KEY& key) {
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 void HashMap<KEY,T,thash>::clear() {
-    for (int i = 0; i < bins; i++){
-        LN* temp = map[i];
-        while (temp -> next != nullptr){
-            LN* to_delete = temp;
-            temp = temp -> next;
-            delete to_delete;
-        }
-        map[i] = temp;
+    //Give back all the pool's blocks at once
+    destroy_hash_table(map, bins);
+    if (old_map != nullptr){
+        destroy_hash_table(old_map, old_bins);
+        old_bins = 0;
+        migrated = 0;
     }
+    pool.release_all();
+    small_nodes.forget_all();
+
+    map = allocate_bins(bins);
+    occupied.reset(bins);
 
     used = 0;
     mod_count++;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::swap(HashMap<KEY,T,thash>& other) {
+    //Nodes in small_nodes cannot change maps, but their keys/values can move. If one map is empty (as
+    //  in a move) the other's move into its unused small_nodes, allocating nothing; otherwise both
+    //  maps' move into pool nodes.
+    if (used == 0){
+        other.evict_small_nodes(&small_nodes);
+    }else if (other.used == 0){
+        evict_small_nodes(&other.small_nodes);
+    }else{
+        evict_small_nodes();
+        other.evict_small_nodes();
+    }
+
+    std::swap(hash,           other.hash);
+    std::swap(map,            other.map);
+    std::swap(load_threshold, other.load_threshold);
+    std::swap(bins,           other.bins);
+    std::swap(min_bins,       other.min_bins);
+    std::swap(used,           other.used);
+    std::swap(old_map,        other.old_map);
+    std::swap(old_bins,       other.old_bins);
+    std::swap(migrated,       other.migrated);
+    std::swap(rehash_step,    other.rehash_step);
+    std::swap(rehash_pace,    other.rehash_pace);
+    pool.swap(other.pool);
+    occupied.swap(other.occupied);
+
+    //A swapped small_bin's contents move to the other map's small_bin, which its pointer must then use
+    std::swap(small_bin,      other.small_bin);
+    for (HashMap<KEY,T,thash>* m : {this, &other}){
+        HashMap<KEY,T,thash>* o = (m == this ? &other : this);
+        if (m -> map == &o -> small_bin){
+            m -> map = &m -> small_bin;
+        }
+        if (m -> old_map == &o -> small_bin){
+            m -> old_map = &m -> small_bin;
+        }
+    }
+    mod_count++;
+    other.mod_count++;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+bool HashMap<KEY,T,thash>::insert_or_assign(const KEY& key, const T& value) {
+    return assign(key, value);
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+bool HashMap<KEY,T,thash>::insert_or_assign(KEY&& key, T&& value) {
+    return assign(std::move(key), std::move(value));
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class... Args>
+bool HashMap<KEY,T,thash>::emplace(Args&&... args) {
+    Entry m_entry(std::forward<Args>(args)...);
+    hash_t<KEY> hashed = hash(m_entry.first);
+    if (find_key(m_entry.first, hashed) != nullptr){
+        return false;
+    }
+    migrate_bins(rehash_pace);
+    link_new(std::move(m_entry.first), std::move(m_entry.second), hashed);
+    mod_count++;
+    return true;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class... Args>
+bool HashMap<KEY,T,thash>::try_emplace(const KEY& key, Args&&... args) {
+    hash_t<KEY> hashed = hash(key);
+    if (find_key(key, hashed) != nullptr){
+        return false;
+    }
+    migrate_bins(rehash_pace);
+    link_new(key, T(std::forward<Args>(args)...), hashed);
+    mod_count++;
+    return true;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class... Args>
+bool HashMap<KEY,T,thash>::try_emplace(KEY&& key, Args&&... args) {
+    hash_t<KEY> hashed = hash(key);
+    if (find_key(key, hashed) != nullptr){
+        return false;
+    }
+    migrate_bins(rehash_pace);
+    link_new(std::move(key), T(std::forward<Args>(args)...), hashed);
+    mod_count++;
+    return true;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class Compute>
+T& HashMap<KEY,T,thash>::compute_if_absent (const KEY& key, Compute compute) {
+    hash_t<KEY> hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    if (temp != nullptr){
+        return temp -> value.second;
+    }
+    migrate_bins(rehash_pace);
+    mod_count++;
+    return link_new(key, compute(key), hashed) -> value.second;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::set_incremental_rehash(int bins_per_step) {
+    rehash_step = std::max(0, bins_per_step);
+    if (rehash_step == 0){
+        migrate_bins(old_bins);
+    }
+    rehash_pace = std::max(rehash_pace, std::size_t(rehash_step));
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::reset_stats() {
+    counters.reset();
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 template<class Iterable>
-int HashMap<KEY,T,thash>::put_all(const Iterable& i) {
-    int count = 0;
-    for (Entry& m_entry : i){
-        count++;
-        put(m_entry.first, m_entry.second);
+std::size_t HashMap<KEY,T,thash>::put_all(const Iterable& i) {
+    std::vector<const Entry*> entries;
+    std::vector<Entry>        copies;
+    gather(i, entries, copies);
+
+    int workers = parallel_workers(entries.size());
+    if (workers > 1){
+        bulk_put(entries, workers);
     }
-    return count;
+    else{
+        for (const Entry* m_entry : entries){
+            put(m_entry -> first, m_entry -> second);
+        }
+    }
+    return entries.size();
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::save(const std::string& file_name) const {
+    typedef MapRecord<KEY,T> Record;
+    static_assert(std::is_trivially_copyable<KEY>::value and std::is_trivially_copyable<T>::value,
+                  "HashMap::save: KEY and T must be trivially copyable");
+    std::vector<Record> records(used);
+    std::size_t         n = 0;
+    for (std::size_t i = occupied.next(0, bins); i < bins; i = occupied.next(i + 1, bins)){
+        for (LN* temp = map[i]; temp != nullptr; temp = temp -> next){
+            fill_record(records[n++], node_hash(temp), temp -> value.first, temp -> value.second);
+        }
+    }
+    for (std::size_t i = migrated; i < old_bins; i++){
+        for (LN* temp = old_map[i]; temp != nullptr; temp = temp -> next){
+            fill_record(records[n++], node_hash(temp), temp -> value.first, temp -> value.second);
+        }
+    }
+    write_snapshot(file_name, SnapshotKind::map, sizeof(KEY), sizeof(T), records);
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::load(const std::string& file_name) {
+    typedef MapRecord<KEY,T> Record;
+    static_assert(std::is_trivially_copyable<KEY>::value and std::is_trivially_copyable<T>::value,
+                  "HashMap::load: KEY and T must be trivially copyable");
+    std::vector<Record> records = read_snapshot<Record>(file_name, SnapshotKind::map, sizeof(KEY), sizeof(T));
+    if (!records.empty() and hash(records[0].key) != records[0].hashed){
+        throw FileOpenError("HashMap::load: " + file_name + " was saved with a different hash function");
+    }
+
+    //The saved keys are distinct and carry their hash values: size map once, then just link nodes
+    clear();
+    std::size_t wanted = bins_for(records.size());
+    if (wanted > bins){
+        start_rehash(wanted);
+        migrate_bins(old_bins);
+    }
+    for (const Record& r : records){
+        std::size_t bin = hash_compress(r.hashed, bins);
+        map[bin] = make_node(r.key, r.value, map[bin]);
+        map[bin] -> store(r.hashed);
+        occupied.set(bin);
+    }
+    used = records.size();
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 //Operators
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 T& HashMap<KEY,T,thash>::operator [] (const KEY& key) {
-    int bin = hash_compress(key);
-    LN* temp = find_key(key);
+    hash_t<KEY> hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    if (temp != nullptr){
+        return temp -> value.second;
+    }
+    migrate_bins(rehash_pace);
+    mod_count++;
+    return link_new(key, T(), hashed) -> value.second;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+T& HashMap<KEY,T,thash>::operator [] (KEY&& key) {
+    hash_t<KEY> hashed = hash(key);
+    LN* temp = find_key(key, hashed);
     if (temp != nullptr){
         return temp -> value.second;
     }
-    map[bin] = new LN(Entry(key, T()), map[bin]);
-    used ++;
+    migrate_bins(rehash_pace);
     mod_count++;
-    return map[bin] -> value.second;
+    return link_new(std::move(key), T(), hashed) -> value.second;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 const T& HashMap<KEY,T,thash>::operator [] (const KEY& key) const {
-    int bin = hash_compress(key);
     LN* temp = find_key(key);
     if (temp == nullptr){
         throw KeyError("");
@@ -417,23 +894,30 @@ const T& HashMap<KEY,T,thash>::operator [] (const KEY& key) const {
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 HashMap<KEY,T,thash>& HashMap<KEY,T,thash>::operator = (const HashMap<KEY,T,thash>& rhs) {
     if (this == &rhs){
         return *this;
     }
-    if (hash == rhs.hash and size() == rhs.size()){
+    if (hash == rhs.hash){
         mod_count++;
+        clear();
+        delete_hash_table(map, bins);
+        bins = rhs.bins;
+        used = rhs.used;
         map  = copy_hash_table(rhs.map, rhs.bins);
+        mark_occupied();
+        if (rhs.old_map != nullptr){
+            old_bins = rhs.old_bins;
+            migrated = rhs.migrated;
+            old_map  = copy_hash_table(rhs.old_map, rhs.old_bins);
+            rehash_pace = std::max(rehash_pace, rhs.rehash_pace);
+        }
     }else {
         mod_count++;
         clear();
-        for (int i = 0; i < rhs.bins; i++) {
-            LN *temp = rhs.map[i];
-            while (temp->next != nullptr) {
-                put(temp->value.first, temp->value.second);
-                temp = temp->next;
-            }
+        for (const Entry& m_entry : rhs) {
+            put(m_entry.first, m_entry.second);
         }
     }
 
@@ -442,7 +926,17 @@ HashMap<KEY,T,thash>& HashMap<KEY,T,thash>::operator = (const HashMap<KEY,T,thas
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+HashMap<KEY,T,thash>& HashMap<KEY,T,thash>::operator = (HashMap<KEY,T,thash>&& rhs) {
+    if (this != &rhs){
+        clear();     //So swap moves rhs's small_nodes into this map's, without allocating
+        swap(rhs);
+    }
+    return *this;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 bool HashMap<KEY,T,thash>::operator == (const HashMap<KEY,T,thash>& rhs) const {
     if (this == &rhs){
         return true;
@@ -451,29 +945,30 @@ bool HashMap<KEY,T,thash>::operator == (const HashMap<KEY,T,thash>& rhs) const {
         return false;
     }
 
-    for (int i = 0; i < bins ; i++){
-        LN* temp = map[i];
-        while (temp -> next != nullptr){
-            if (temp -> value.second != rhs[temp -> value.first]){
-                return false;
-            }
-            temp = temp -> next;
+    for (const Entry& m_entry : *this){
+        LN* temp = rhs.find_key(m_entry.first);
+        if (temp == nullptr or m_entry.second != temp -> value.second){
+            return false;
         }
     }
     return true;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 bool HashMap<KEY,T,thash>::operator != (const HashMap<KEY,T,thash>& rhs) const {
     return !(*this == rhs);
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 std::ostream& operator << (std::ostream& outs, const HashMap<KEY,T,thash>& m) {
     outs << "map[";
-
+    bool first = true;
+    for (const auto& m_entry : m){
+        outs << (first ? "" : ",") << m_entry.first << "->" << m_entry.second;
+        first = false;
+    }
     outs << "]";
     return outs;
 }
@@ -484,13 +979,13 @@ std::ostream& operator << (std::ostream& outs, const HashMap<KEY,T,thash>& m) {
 //
 //Iterator constructors
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 auto HashMap<KEY,T,thash>::begin () const -> HashMap<KEY,T,thash>::Iterator {
     return Iterator(const_cast<HashMap<KEY, T, thash>*>(this), true);
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 auto HashMap<KEY,T,thash>::end () const -> HashMap<KEY,T,thash>::Iterator {
     return Iterator(const_cast<HashMap<KEY, T, thash>*>(this), false);
 }
@@ -500,98 +995,456 @@ auto HashMap<KEY,T,thash>::end () const -> HashMap<KEY,T,thash>::Iterator {
 //
 //Private helper methods
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-int HashMap<KEY,T,thash>::hash_compress (const KEY& key) const {
-    return abs(hash(key)) % bins;
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::size_t HashMap<KEY,T,thash>::hash_compress (hash_t<KEY> hashed, std::size_t bins) const {
+    return hash_bin<masked>(hashed, bins);
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::size_t HashMap<KEY,T,thash>::bins_for (std::size_t count) const {
+    if (count <= std::size_t(SMALL)){
+        return 1;
+    }
+    return bin_count<masked, std::size_t, hash_t<KEY>>(std::size_t(std::min(double(max_bins<std::size_t, hash_t<KEY>>()), double(count) / load_threshold)));
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+hash_t<KEY> HashMap<KEY,T,thash>::node_hash (const LN* node) const {
+    return (node -> cached ? node -> hashed() : hash(node -> value.first));
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 typename HashMap<KEY,T,thash>::LN* HashMap<KEY,T,thash>::find_key (const KEY& key) const {
-    for (LN* temp = map[hash_compress(key)]; temp -> next != nullptr; temp = temp -> next){
-        if (key == temp -> value.first){
+    return find_key(key, hash(key));
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class KEY2>
+typename HashMap<KEY,T,thash>::LN* HashMap<KEY,T,thash>::find_key (const KEY2& key, hash_t<KEY> hashed) const {
+    std::size_t walked = 0;
+    for (LN* temp = map[hash_compress(hashed, bins)]; temp != nullptr; temp = temp -> next){
+        walked++;
+        if (temp -> may_equal(hashed) and key == temp -> value.first){
+            counters.lookup(walked, true);
             return temp;
         }
     }
+    if (old_map != nullptr){
+        //Bins already migrated are empty, so they need no special case
+        for (LN* temp = old_map[hash_compress(hashed, old_bins)]; temp != nullptr; temp = temp -> next){
+            walked++;
+            if (temp -> may_equal(hashed) and key == temp -> value.first){
+                counters.lookup(walked, true);
+                return temp;
+            }
+        }
+    }
+    counters.lookup(walked, false);
     return nullptr;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-typename HashMap<KEY,T,thash>::LN* HashMap<KEY,T,thash>::copy_list (LN* l) const {
-    if (l -> next == nullptr){
-        return new LN();
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+typename HashMap<KEY,T,thash>::LN** HashMap<KEY,T,thash>::find_link (const KEY& key) {
+    hash_t<KEY> hashed = hash(key);
+    for (LN** link = &map[hash_compress(hashed, bins)]; *link != nullptr; link = &(*link) -> next){
+        if ((*link) -> may_equal(hashed) and key == (*link) -> value.first){
+            return link;
+        }
     }
-    LN* to_return = new LN(l -> value, new LN());
-    LN* temp = l;
-    temp = temp -> next;
-    while (temp -> next != nullptr){
-        to_return = new LN(temp -> value, to_return);
-        temp = temp -> next;
+    if (old_map != nullptr){
+        for (LN** link = &old_map[hash_compress(hashed, old_bins)]; *link != nullptr; link = &(*link) -> next){
+            if ((*link) -> may_equal(hashed) and key == (*link) -> value.first){
+                return link;
+            }
+        }
     }
-    return to_return;
+    return nullptr;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-typename HashMap<KEY,T,thash>::LN** HashMap<KEY,T,thash>::copy_hash_table (LN** ht, int bins) const {
-    LN ** to_return = new LN* [bins];
-    for (int i = 0; i < bins; i++){
-        to_return[i] = copy_list(ht[i]);
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class Found>
+void HashMap<KEY,T,thash>::find_batch (const KEY* keys, std::size_t n, Found found) const {
+    int         hashes[BATCH];
+    std::size_t bin[BATCH];
+    LN*         head[BATCH];
+    for (std::size_t first = 0; first < n; first += BATCH){
+        int count = int(std::min(std::size_t(BATCH), n - first));
+
+        //Hash every key in the group and prefetch its bin; then read the bins and prefetch their first nodes
+        for (int k = 0; k < count; k++){
+            hashes[k] = hash(keys[first + k]);
+            bin[k]    = hash_compress(hashes[k], bins);
+            prefetch(&map[bin[k]]);
+        }
+        for (int k = 0; k < count; k++){
+            head[k] = map[bin[k]];
+            prefetch(head[k]);
+        }
+
+        //Now search each chain, starting at a (probably) cached node
+        for (int k = 0; k < count; k++){
+            const KEY& key = keys[first + k];
+            LN* temp = head[k];
+            std::size_t walked = 0;
+            for (; temp != nullptr; temp = temp -> next){
+                walked++;
+                if (temp -> may_equal(hashes[k]) and key == temp -> value.first){
+                    break;
+                }
+            }
+            if (temp == nullptr and old_map != nullptr){
+                temp = find_key(key, hashes[k]);   //Counts the lookup itself
+            }
+            else{
+                counters.lookup(walked, temp != nullptr);
+            }
+            found(first + k, temp);
+        }
     }
-    return to_return;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-void HashMap<KEY,T,thash>::ensure_load_threshold(int new_used) {
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class K, class V>
+typename HashMap<KEY,T,thash>::LN* HashMap<KEY,T,thash>::link_new (K&& key, V&& value, hash_t<KEY> hashed) {
+    ensure_load_threshold(used + 1);
+    used++;
+    std::size_t bin = hash_compress(hashed, bins);
+    map[bin] = make_node(std::forward<K>(key), std::forward<V>(value), map[bin]);
+    map[bin] -> store(hashed);
+    occupied.set(bin);
+    return map[bin];
+}
 
-    if (double(new_used) / double(bins) > load_threshold){
-        LN** temp_map = map;
-        int temp_bins = bins;
 
-        map = new LN*[temp_bins * 2];
-        bins = temp_bins * 2;
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class K, class V>
+bool HashMap<KEY,T,thash>::assign (K&& key, V&& value) {
+    migrate_bins(rehash_pace);
+    mod_count++;
+    hash_t<KEY> hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    if (temp != nullptr){
+        temp -> value.second = std::forward<V>(value);
+        return false;
+    }
+    link_new(std::forward<K>(key), std::forward<V>(value), hashed);
+    return true;
+}
 
-        for (int i = 0; i < bins; i++){
-            map[i] = new LN();
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+template<class... Args>
+typename HashMap<KEY,T,thash>::LN* HashMap<KEY,T,thash>::make_node (Args&&... args) const {
+    LN* node = small_nodes.make(std::forward<Args>(args)...);
+    return node != nullptr ? node : pool.make(std::forward<Args>(args)...);
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::recycle_node (LN* node) {
+    if (small_nodes.owns(node)){
+        small_nodes.recycle(node);
+    }
+    else{
+        pool.recycle(node);
+    }
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::destroy_node (LN* node) {
+    if (small_nodes.owns(node)){
+        small_nodes.recycle(node);
+    }
+    else{
+        pool.destroy(node);
+    }
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::evict_small_nodes (InlineNodes<LN,SMALL>* into) {
+    for (int i = 0; i < SMALL and !small_nodes.empty(); i++){
+        LN* node = small_nodes.at(i);
+        if (node == nullptr){
+            continue;
         }
 
-        for (int i = 0; i < temp_bins; i++){
-            LN* temp = temp_map[i];
-            while (temp -> next != nullptr){
-                int xd = hash_compress(temp -> value.first);
-                LN* hehe = temp;
-                temp = temp -> next;
-                hehe -> next = map[xd];
-                map[xd] = hehe;
+        //Find the link to node: in its bin of map, else in its (unmigrated) bin of old_map
+        hash_t<KEY> hashed = node_hash(node);
+        LN** link = &map[hash_compress(hashed, bins)];
+        while (*link != nullptr and *link != node){
+            link = &(*link) -> next;
+        }
+        if (*link == nullptr){
+            link = &old_map[hash_compress(hashed, old_bins)];
+            while (*link != node){
+                link = &(*link) -> next;
             }
-            delete temp;
         }
 
+        //into is empty and has as many slots as small_nodes, so its make always succeeds
+        if (into != nullptr){
+            *link = into -> make(std::move_if_noexcept(node -> value.first), std::move_if_noexcept(node -> value.second), node -> next);
+        }else{
+            *link = pool.make(std::move_if_noexcept(node -> value.first), std::move_if_noexcept(node -> value.second), node -> next);
+        }
+        (*link) -> store(hashed);
+        small_nodes.recycle(node);
+    }
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+typename HashMap<KEY,T,thash>::LN** HashMap<KEY,T,thash>::allocate_bins (std::size_t count) {
+    if (count == 1){
+        small_bin = nullptr;
+        return &small_bin;
+    }
+    return new LN*[count]();
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::free_bins (LN** ht) {
+    if (ht != &small_bin){
+        delete[] ht;
+    }
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::mark_occupied (int workers) {
+    occupied.reset(bins);
+    parallel_ranges(workers, occupied.word_count(), [&] (int, std::size_t begin, std::size_t end) {
+        for (std::size_t w = begin; w < end; w++){
+            std::uint64_t bits = 0;
+            for (std::size_t i = w * 64, last = std::min(bins, i + 64); i < last; i++){
+                bits |= std::uint64_t(map[i] != nullptr) << (i & 63);
+            }
+            occupied.word(w) = bits;
+        }
+    });
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::unlinked (LN** link) {
+    //link is a bin of map (not a node's next, nor a bin of old_map) only if it points into map's array
+    std::less<LN**> before;
+    if (*link == nullptr and !before(link, map) and before(link, map + bins)){
+        occupied.clear(std::size_t(link - map));
+    }
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+typename HashMap<KEY,T,thash>::LN* HashMap<KEY,T,thash>::copy_list (LN* l) const {
+    LN* to_return = nullptr;
+    for (LN* temp = l; temp != nullptr; temp = temp -> next){
+        to_return = make_node(*temp, to_return);
+    }
+    return to_return;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+typename HashMap<KEY,T,thash>::LN** HashMap<KEY,T,thash>::copy_hash_table (LN** ht, std::size_t bins) {
+    LN ** to_return = allocate_bins(bins);
+    for (std::size_t i = 0; i < bins; i++){
+        to_return[i] = copy_list(ht[i]);
+    }
+    return to_return;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::ensure_load_threshold(std::size_t new_used) {
+    if (double(new_used) / double(bins) > load_threshold){
+        //A small map keeps its 1 bin; once it outgrows it, go straight to the bins its keys need
+        if (bins == 1){
+            std::size_t wanted = bins_for(new_used);
+            if (wanted > bins){
+                start_rehash(wanted);
+            }
+            return;
+        }
+        //Doubling is capped (see max_bins), so bins * 2 never overflows: past it, the chains just grow
+        if (bins >= max_bins<std::size_t, hash_t<KEY>>()){
+            return;
+        }
+        start_rehash(bins * 2);
+    }
+    else if (bins / 2 >= min_bins and double(new_used) / double(bins) < load_threshold / 4.0){
+        start_rehash(bins / 2);
+    }
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::start_rehash(std::size_t new_bins) {
+    auto start = counters.resize_start();
+
+    //Only one rehash is in progress at a time: finish the current one first (with rehash_pace set
+    //  below, nothing is left of it by the time the next one starts)
+    migrate_bins(old_bins);
+
+    old_map  = map;
+    old_bins = bins;
+    migrated = 0;
+
+    map  = allocate_bins(new_bins);
+    bins = new_bins;
+    occupied.reset(new_bins);
+
+    //Every put/erase changes used by at most 1 and migrates rehash_pace bins first, so migrating
+    //  old_bins/mutations per mutation ends this rehash before used can reach either resize threshold
+    //  (ensure_load_threshold): above load_threshold*bins, or below load_threshold*bins/4
+    if (rehash_step == 0){
+        rehash_pace = old_bins;
     }
     else{
+        double to_grow   = std::floor(load_threshold * double(bins)) - double(used);
+        double to_shrink = (bins / 2 >= min_bins ? double(used) - std::ceil(load_threshold * double(bins) / 4.0) : to_grow);
+        double mutations = std::max(1.0, std::min(to_grow, to_shrink));
+        rehash_pace = std::max(std::size_t(rehash_step), std::size_t(std::ceil(double(old_bins) / mutations)));
+    }
+    migrate_bins(rehash_pace);
+    counters.resize_end(start);
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::migrate_bins(std::size_t count) {
+    if (old_map == nullptr){
         return;
     }
 
+    for (; count > 0 and migrated < old_bins; count--, migrated++){
+        LN* temp = old_map[migrated];
+        while (temp != nullptr){
+            std::size_t xd = hash_compress(node_hash(temp), bins);
+            LN* hehe = temp;
+            temp = temp -> next;
+            hehe -> next = map[xd];
+            map[xd] = hehe;
+            occupied.set(xd);
+        }
+        old_map[migrated] = nullptr;
+    }
+
+    if (migrated == old_bins){
+        delete_hash_table(old_map, old_bins);
+        old_bins = 0;
+        migrated = 0;
+    }
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
-void HashMap<KEY,T,thash>::delete_hash_table (LN**& ht, int bins) {
-    for (int i = 0; i < bins; i++){
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::delete_hash_table (LN**& ht, std::size_t bins) {
+    for (std::size_t i = 0; i < bins; i++){
         LN* temp = ht[i];
         while (temp != nullptr){
             LN* to_delete = temp;
             temp = temp -> next;
-            delete to_delete;
+            recycle_node(to_delete);
         }
     }
-    delete[] ht;
+    free_bins(ht);
     ht = nullptr;
 }
 
 
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::destroy_hash_table (LN**& ht, std::size_t bins) {
+    if (NodePool<LN>::needs_destroy){
+        for (std::size_t i = 0; i < bins; i++){
+            LN* temp = ht[i];
+            while (temp != nullptr){
+                LN* to_destroy = temp;
+                temp = temp -> next;
+                destroy_node(to_destroy);
+            }
+        }
+    }
+    free_bins(ht);
+    ht = nullptr;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+void HashMap<KEY,T,thash>::bulk_put (const std::vector<const Entry*>& entries, int workers) {
+    std::size_t n = entries.size();
+    mod_count++;
+
+    //Size map for every entry up front (so no thread ever rehashes), and only link into map
+    migrate_bins(old_bins);
+    std::size_t wanted = bins_for(used + n);
+    if (wanted > bins){
+        start_rehash(wanted);
+        migrate_bins(old_bins);
+    }
+
+    std::vector<hash_t<KEY>> hashes(n);
+    parallel_ranges(workers, n, [&] (int, std::size_t begin, std::size_t end) {
+        for (std::size_t j = begin; j < end; j++){
+            hashes[j] = hash(entries[j] -> first);
+        }
+    });
+
+    //Each part is a range of consecutive bins, so the threads linking different parts never share a bin
+    int parts = int(std::min(bins, std::size_t(8 * workers)));
+    std::vector<std::size_t> order, starts;
+    parallel_partition(workers, n, parts, [&] (std::size_t j) {
+        return int(static_cast<unsigned long long>(hash_compress(hashes[j], bins)) * parts / bins);
+    }, order, starts);
+
+    std::unique_ptr<NodePool<LN>[]> pools(new NodePool<LN>[workers]);
+    std::vector<std::size_t> added(workers, 0);
+    auto absorb_pools = [&] () {
+        for (int w = 0; w < workers; w++){
+            pool.absorb(pools[w]);
+            used += added[w];
+        }
+        mark_occupied(workers);   //Threads linking neighboring parts may share a word, so set the bits after
+    };
+    try{
+        parallel_for(workers, parts, [&] (int worker, int part) {
+            for (std::size_t k = starts[part]; k < starts[part + 1]; k++){
+                const Entry& m_entry = *entries[order[k]];
+                hash_t<KEY> hashed = hashes[order[k]];
+                std::size_t bin = hash_compress(hashed, bins);
+                LN* temp   = map[bin];
+                while (temp != nullptr and !(temp -> may_equal(hashed) and m_entry.first == temp -> value.first)){
+                    temp = temp -> next;
+                }
+                if (temp != nullptr){
+                    temp -> value.second = m_entry.second;
+                }
+                else{
+                    map[bin] = pools[worker].make(m_entry.first, m_entry.second, map[bin]);
+                    map[bin] -> store(hashed);
+                    added[worker]++;
+                }
+            }
+        });
+    }catch (...){
+        //Keep (and count) the entries linked so far before passing on the exception
+        absorb_pools();
+        throw;
+    }
+    absorb_pools();
+}
+
+
 
 
 
@@ -600,26 +1453,36 @@ void HashMap<KEY,T,thash>::delete_hash_table (LN**& ht, int bins) {
 //
 //Iterator class definitions
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 void HashMap<KEY,T,thash>::Iterator::advance_cursors(){
-    if (current.second != nullptr and current.second -> next != nullptr and current.second -> next -> next != nullptr){
+    if (current.second != nullptr and current.second -> next != nullptr){
         current.second = current.second -> next;
         return;
     }
     else {
-        for (int i = current.first + 1; i < ref_map->bins; i++) {
-            if (ref_map -> map[i] -> next != nullptr) {
-                current.first = i;
-                current.second = ref_map->map[i];
+        //Bins [0,old_bins) are in old_map (during an incremental rehash); the rest are in map, whose
+        //  nonempty bins occupied finds without loading the empty ones
+        std::size_t old_bins = ref_map->old_bins;
+        std::size_t i = std::size_t(current.first + 1);
+        for (; i < old_bins; i++) {
+            if (ref_map->old_map[i] != nullptr) {
+                current.first = std::ptrdiff_t(i);
+                current.second = ref_map->old_map[i];
                 return;
             }
         }
+        i = ref_map->occupied.next(i - old_bins, ref_map->bins);
+        if (i < ref_map->bins) {
+            current.first = std::ptrdiff_t(old_bins + i);
+            current.second = ref_map->map[i];
+            return;
+        }
     }
     current.first = -1;
     current.second = nullptr;
 }
 //xd
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 HashMap<KEY,T,thash>::Iterator::Iterator(HashMap<KEY,T,thash>* iterate_over, bool from_begin)
         : ref_map(iterate_over), expected_mod_count(ref_map->mod_count) {
     current = Cursor(-1, nullptr);
@@ -629,12 +1492,12 @@ HashMap<KEY,T,thash>::Iterator::Iterator(HashMap<KEY,T,thash>* iterate_over, boo
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 HashMap<KEY,T,thash>::Iterator::~Iterator()
 {}
 
 //xd
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 auto HashMap<KEY,T,thash>::Iterator::erase() -> Entry {
     if (expected_mod_count != ref_map -> mod_count){
         throw ConcurrentModificationError("HashMap::Iterator::erase");
@@ -646,20 +1509,31 @@ auto HashMap<KEY,T,thash>::Iterator::erase() -> Entry {
         throw CannotEraseError("HashMap::Iterator::erase Iterator cursor beyond data structure");
     }
 
+    //Unlink the node directly (not via ref_map->erase) so the table is never resized/migrated under
+    //  the cursor; then position current at the following node, which ++ will not skip
+    can_erase = false;
     Entry to_return = current.second -> value;
-
+    LN** link = ref_map -> find_link(to_return.first);
+    LN*  to_delete = *link;
+    *link = to_delete -> next;
+    ref_map -> unlinked(link);
+    advance_cursors();
+    ref_map -> recycle_node(to_delete);
+    ref_map -> used--;
+    ref_map -> mod_count++;
+    expected_mod_count = ref_map -> mod_count;
     return to_return;
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 std::string HashMap<KEY,T,thash>::Iterator::str() const {
     std::ostringstream answer;
     answer << ref_map -> str() << "(current=" << current.first << ",expected_mod_count=" << expected_mod_count << ",can_erase" << can_erase << ")";
     return  answer.str();
 }
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 auto  HashMap<KEY,T,thash>::Iterator::operator ++ () -> HashMap<KEY,T,thash>::Iterator& {
     if (expected_mod_count != ref_map -> mod_count){
         throw ConcurrentModificationError("HashMap::Iterator::operator ++");
@@ -667,7 +1541,7 @@ auto  HashMap<KEY,T,thash>::Iterator::operator ++ () -> HashMap<KEY,T,thash>::It
     if (current.second == nullptr){
         return *this;
     }
-    if (can_erase or current.second -> next == nullptr){
+    if (can_erase){
         advance_cursors();
     }
     can_erase = true;
@@ -675,7 +1549,7 @@ auto  HashMap<KEY,T,thash>::Iterator::operator ++ () -> HashMap<KEY,T,thash>::It
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 auto  HashMap<KEY,T,thash>::Iterator::operator ++ (int) -> HashMap<KEY,T,thash>::Iterator {
     if (expected_mod_count != ref_map -> mod_count){
         throw ConcurrentModificationError("HashMap::Iterator::operator ++(int)");
@@ -684,7 +1558,7 @@ auto  HashMap<KEY,T,thash>::Iterator::operator ++ (int) -> HashMap<KEY,T,thash>:
         return *this;
     }
     Iterator to_return(*this);
-    if (can_erase or current.second -> next == nullptr){
+    if (can_erase){
         advance_cursors();
     }
     can_erase = true;
@@ -692,7 +1566,7 @@ auto  HashMap<KEY,T,thash>::Iterator::operator ++ (int) -> HashMap<KEY,T,thash>:
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 bool HashMap<KEY,T,thash>::Iterator::operator == (const HashMap<KEY,T,thash>::Iterator& rhs) const {
     const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
     if (rhsASI == 0){
@@ -708,7 +1582,7 @@ bool HashMap<KEY,T,thash>::Iterator::operator == (const HashMap<KEY,T,thash>::It
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 bool HashMap<KEY,T,thash>::Iterator::operator != (const HashMap<KEY,T,thash>::Iterator& rhs) const {
     const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
     if (rhsASI == 0){
@@ -724,7 +1598,7 @@ bool HashMap<KEY,T,thash>::Iterator::operator != (const HashMap<KEY,T,thash>::It
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 pair<KEY,T>& HashMap<KEY,T,thash>::Iterator::operator *() const {
     if (expected_mod_count != ref_map -> mod_count){
         throw ConcurrentModificationError("HashMap::Iterator::operator *");
@@ -736,7 +1610,7 @@ pair<KEY,T>& HashMap<KEY,T,thash>::Iterator::operator *() const {
 }
 
 
-template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
 pair<KEY,T>* HashMap<KEY,T,thash>::Iterator::operator ->() const {
     if (expected_mod_count != ref_map -> mod_count){
         throw ConcurrentModificationError ("HashMap::Iterator::operator *");
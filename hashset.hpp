@@ -9,8 +9,19 @@
 #include <iostream>
 #include <sstream>
 #include <initializer_list>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
 #include "ics_exceptions.hpp"
 #include "pair.hpp"
+#include "nodepool.hpp"
+#include "hashing.hpp"
+#include "parallel.hpp"
+#include "hashsnapshot.hpp"
+#include "hashstats.hpp"
 
 
 namespace ics {
@@ -19,61 +30,117 @@ namespace ics {
 #ifndef undefinedhashdefined
 #define undefinedhashdefined
 template<class T>
-int undefinedhash (const T& a) {return 0;}
+hash_t<T> undefinedhash (const T& a) {return 0;}
 #endif /* undefinedhashdefined */
 
-//Instantiate the templated class supplying thash(a): produces a hash value for a.
+//Instantiate the templated class supplying thash(a): produces a hash value for a (an int, or a
+//  std::uint64_t when hash64 is specialized true for the key type: see hashing.hpp).
 //If thash is defaulted to undefinedhash in the template, then a constructor must supply chash.
 //If both thash and chash are supplied, then they must be the same (by ==) function.
 //If neither is supplied, or both are supplied but different, TemplateFunctionError is raised.
 //The (unique) non-undefinedhash value supplied by thash/chash is stored in the instance variable hash.
-template<class T, int (*thash)(const T& a) = undefinedhash<T>> class HashSet {
+//Small mode: while it holds at most SMALL (up to 8) elements, an instance allocates nothing: its 1 bin
+//  and first nodes are inside the object. So swap and moving the object (not its elements) relocate
+//  those nodes: references into a small instance do not survive them.
+template<class T, hash_t<T> (*thash)(const T& a) = undefinedhash<T>> class HashSet {
   public:
-    typedef int (*hashfunc) (const T& a);
+    typedef hash_t<T> (*hashfunc) (const T& a);
 
     //Destructor/Constructors
     ~HashSet ();
 
-    HashSet (double the_load_threshold = 1.0, int (*chash)(const T& a) = nullptr);
-    explicit HashSet (int initial_bins, double the_load_threshold = 1.0, int (*chash)(const T& k) = nullptr);
-    HashSet (const HashSet<T,thash>& to_copy, double the_load_threshold = 1.0, int (*chash)(const T& a) = nullptr);
-    explicit HashSet (const std::initializer_list<T>& il, double the_load_threshold = 1.0, int (*chash)(const T& a) = nullptr);
+    HashSet (double the_load_threshold = 1.0, hash_t<T> (*chash)(const T& a) = nullptr);
+    explicit HashSet (int initial_bins, double the_load_threshold = 1.0, hash_t<T> (*chash)(const T& k) = nullptr);
+    HashSet (const HashSet<T,thash>& to_copy, double the_load_threshold = 1.0, hash_t<T> (*chash)(const T& a) = nullptr);
+    HashSet (HashSet<T,thash>&& to_move);  //to_move is left empty (with 1 bin)
+    explicit HashSet (const std::initializer_list<T>& il, double the_load_threshold = 1.0, hash_t<T> (*chash)(const T& a) = nullptr);
 
     //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
     template <class Iterable>
-    explicit HashSet (const Iterable& i, double the_load_threshold = 1.0, int (*chash)(const T& a) = nullptr);
+    explicit HashSet (const Iterable& i, double the_load_threshold = 1.0, hash_t<T> (*chash)(const T& a) = nullptr);
 
 
     //Queries
     bool empty      () const;
-    int  size       () const;
+    std::size_t size () const;
     bool contains   (const T& element) const;
     std::string str () const; //supplies useful debugging information; contrast to operator <<
+    hashfunc    hash_function () const; //The hash function in use (thash or chash)
+
+    //Transparent lookup: element need not be a T (e.g., std::string_view for std::string elements), so
+    //  no temporary T is built. T2 == T must be defined, and hash2(element) must equal hash(t) for
+    //  every T t == element.
+    template <class T2>
+    bool contains   (const T2& element, hash_t<T> (*hash2)(const T2& k)) const;
 
     //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
     template <class Iterable>
     bool contains_all (const Iterable& i) const;
 
+    //Batched lookup: found[i] = contains(elements[i]) for i in [0,n); returns the # found. The elements
+    //  are hashed and their bins/first nodes prefetched in groups, so the cache misses overlap.
+    std::size_t contains_batch (const T* elements, std::size_t n, bool* found) const;
+
+    //The table's shape and (with ICS_HASH_STATS) its lookup/resize activity: see hashstats.hpp
+    HashStats stats () const;
+
 
     //Commands
     int  insert (const T& element);
+    int  insert (T&& element);
     int  erase  (const T& element);
     void clear  ();
+    void swap   (HashSet<T,thash>& other);
 
-    //Iterable class must support "for" loop: .begin()/.end() and prefix ++ on returned result
+    //Constructs an element from args and inserts it if it is new (returning 1; else 0)
+    template <class... Args>
+    int  emplace (Args&&... args);
 
+    //Zeroes the activity counters reported by stats()
+    void reset_stats ();
+
+    //Iterable class must support "for" loop: .begin()/.end() and prefix ++ on returned result
+    //With enough elements (see parallel.hpp) insert_all hashes them, partitions them by bin, and links
+    //  them in on several threads; the result is the same as inserting them one at a time, but hash
+    //  and T ==/copying must be thread-safe.
     template <class Iterable>
-    int insert_all(const Iterable& i);
+    std::size_t insert_all(const Iterable& i);
 
     template <class Iterable>
-    int erase_all(const Iterable& i);
+    std::size_t erase_all(const Iterable& i);
 
+    //Removes every element not in i; returns the # removed
     template<class Iterable>
-    int retain_all(const Iterable& i);
+    std::size_t retain_all(const Iterable& i);
+
+    //Set algebra with another HashSet, in linear time: each visits the nodes of the smaller set when
+    //  it can, and uses the hash values cached in the nodes when both sets use the same hash function.
+    //Large sets are processed on several threads (see parallel.hpp): with the same hash function, both
+    //  sets' bins are split the same way, so each thread reads/writes only its own bins.
+    //In place (reusing this set's nodes), returning the # of elements added/removed:
+    //  insert_all (union), retain_all (intersection), erase_all (difference), symmetric_difference_all.
+    std::size_t insert_all               (const HashSet<T,thash>& s);
+    std::size_t erase_all                (const HashSet<T,thash>& s);
+    std::size_t retain_all               (const HashSet<T,thash>& s);
+    std::size_t symmetric_difference_all (const HashSet<T,thash>& s);
+    bool contains_all             (const HashSet<T,thash>& s) const;
+
+    //As new sets (with this set's hash function and load_threshold, presized for the result)
+    HashSet<T,thash> set_union            (const HashSet<T,thash>& rhs) const;
+    HashSet<T,thash> set_intersection     (const HashSet<T,thash>& rhs) const;
+    HashSet<T,thash> set_difference       (const HashSet<T,thash>& rhs) const;
+    HashSet<T,thash> symmetric_difference (const HashSet<T,thash>& rhs) const;
+
+    //Binary snapshots (see hashsnapshot.hpp); T must be trivially copyable. save writes every element
+    //  to file_name; load replaces this set's elements by those saved in file_name (FileOpenError unless
+    //  it is a snapshot of a set of T saved with this hash function). See also MappedHashSet.
+    void save (const std::string& file_name) const;
+    void load (const std::string& file_name);
 
 
     //Operators
     HashSet<T,thash>& operator = (const HashSet<T,thash>& rhs);
+    HashSet<T,thash>& operator = (HashSet<T,thash>&& rhs);
     bool operator == (const HashSet<T,thash>& rhs) const;
     bool operator != (const HashSet<T,thash>& rhs) const;
     bool operator <= (const HashSet<T,thash>& rhs) const;
@@ -81,7 +148,7 @@ template<class T, int (*thash)(const T& a) = undefinedhash<T>> class HashSet {
     bool operator >= (const HashSet<T,thash>& rhs) const;
     bool operator >  (const HashSet<T,thash>& rhs) const;
 
-    template<class T2, int (*hash2)(const T2& a)>
+    template<class T2, hash_t<T2> (*hash2)(const T2& a)>
     friend std::ostream& operator << (std::ostream& outs, const HashSet<T2,hash2>& s);
 
 
@@ -92,7 +159,7 @@ template<class T, int (*thash)(const T& a) = undefinedhash<T>> class HashSet {
   public:
     class Iterator {
       public:
-        typedef pair<int,LN*> Cursor;
+        typedef pair<std::ptrdiff_t,LN*> Cursor;
 
         //Private constructor called in begin/end, which are friends of HashSet<T,thash>
         ~Iterator();
@@ -131,34 +198,86 @@ template<class T, int (*thash)(const T& a) = undefinedhash<T>> class HashSet {
 
 
   private:
-    class LN {
+    //Unless cache_hash<T> is false, each LN also stores hash(value) (see hashing.hpp)
+    class LN : public HashCache<cache_hash<T>::value,hash_t<T>> {
       public:
         LN ()                      {}
-        LN (const LN& ln)          : value(ln.value), next(ln.next){}
-        LN (T v,  LN* n = nullptr) : value(v), next(n){}
+        LN (const LN& ln)          : HashCache<cache_hash<T>::value,hash_t<T>>(ln), value(ln.value), next(ln.next){}
+        LN (const LN& ln, LN* n)   : HashCache<cache_hash<T>::value,hash_t<T>>(ln), value(ln.value), next(n){}
+        LN (T v,  LN* n = nullptr) : value(std::move(v)), next(n){}
 
         T   value;
         LN* next   = nullptr;
     };
 
 public:
-  int (*hash)(const T& k);   //Hashing function used (from template or constructor)
+  HashFunction<T,thash> hash; //Hashing function used (from template or constructor)
 private:
-  LN** set      = nullptr;   //Pointer to array of pointers: each bin stores a list with a trailer node
+  LN** set      = nullptr;   //Pointer to array of pointers: each bin stores a nullptr-terminated list (empty bins allocate nothing)
   double load_threshold;     //used/bins <= load_threshold
-  int bins      = 1;         //# bins in array (should start >= 1 so hash_compress doesn't % 0)
-  int used      = 0;         //Cache for number of key->value pairs in the hash table
+  std::size_t bins = 1;      //# bins in array: >= 1, and a power of two when masked (see bin_count)
+  std::size_t used = 0;      //Cache for number of key->value pairs in the hash table
   int mod_count = 0;         //For sensing concurrent modification
 
+  mutable NodePool<LN> pool; //Allocates every LN in set not in small_nodes (copy_list is const)
+  HashCounters counters;     //Lookup/resize activity for stats (counted only with ICS_HASH_STATS)
+
+  //Small mode: a set of at most SMALL elements keeps 1 bin (searched linearly) and its nodes inside
+  //  the object, so the many tiny sets a program may create and destroy allocate nothing at all
+  static constexpr int SMALL = inline_node_count<LN>(8);
+  LN* small_bin = nullptr;                    //set when it has 1 bin (see allocate_bins)
+  mutable InlineNodes<LN,SMALL> small_nodes;  //The first nodes made (see make_node)
+
+  static constexpr int BATCH = 16;  //# elements contains_batch prefetches before resolving any of them
+
+  static constexpr bool masked = mask_bins<T>::value;     //bins is a power of two; hash_compress masks
 
   //Helper methods
-  int   hash_compress        (const T& key)              const;  //hash function ranged to [0,bins-1]
+  std::size_t hash_compress  (hash_t<T> hashed, std::size_t bins) const;  //hash value ranged to [0,bins-1]
+  std::size_t bins_for       (std::size_t count)        const;  //# bins (see bin_count) that count elements need at load_threshold
+  hash_t<T> node_hash        (const LN* node)            const;  //hash(node's value), from the node if it caches it
   LN*   find_element         (const T& element)          const;  //Returns reference to element's node or nullptr
+  template <class T2>
+  LN*   find_element         (const T2& element, hash_t<T> hashed) const;  //Same, given hashed == hash(element)
+  LN**  find_link            (const T& element);                 //Returns the pointer (bin or next) to element's node or nullptr
+  LN**  find_link            (const T& element, hash_t<T> hashed);     //Same, given hashed == hash(element)
+  hash_t<T> hash_of          (const HashSet<T,thash>& from, const LN* node) const;  //hash(node's value), for node in from
+  bool  contains_node        (const HashSet<T,thash>& from, const LN* node) const;  //contains(node's value), for node in from
+  bool  subset_of            (const HashSet<T,thash>& rhs)       const;  //Every element of this is in rhs
+  void  reserve              (std::size_t new_used);               //Grow now, so new_used elements fit without a rehash
+
+  //The set algebra changes this set's bins through Workers (one per thread): each links in nodes from
+  //  its own pool and unlinks nodes onto its own list, and merge_workers then combines them serially
+  class alignas(64) Worker {
+    public:
+      NodePool<LN> pool;
+      LN*          erased  = nullptr;  //Unlinked nodes (chained through next), to recycle
+      std::size_t  added   = 0;
+      std::size_t  removed = 0;
+  };
+  template <class Erase>
+  std::size_t erase_nodes    (Erase erase);                      //Erase every node n with erase(n) true; returns the #
+  template <class Visit>
+  std::size_t visit_nodes    (const HashSet<T,thash>& from, Visit visit);  //visit(worker, n) for each node n in from
+  void  link_in              (Worker& w, const T& element, hash_t<T> hashed);    //Link in an absent element (after reserve)
+  void  unlink_to            (Worker& w, LN** link);             //Unlink *link onto w.erased
+  std::size_t merge_workers  (Worker* w, int workers);           //Returns the # of nodes added/removed
+  template <class... Args>
+  LN*   make_node            (Args&&... args)            const;  //Construct a node in small_nodes if it has room, else in pool
+  void  recycle_node         (LN* node);                         //Destroy node and reuse its memory
+  void  destroy_node         (LN* node);                         //Destroy node without reusing its memory (before pool.release_all)
+  void  evict_small_nodes    (InlineNodes<LN,SMALL>* into = nullptr); //Move any nodes in small_nodes into into's (empty) slots, else pool nodes
+  LN**  allocate_bins        (std::size_t count);                //Zeroed array of count bins: &small_bin when count == 1
+  void  free_bins            (LN** ht);                          //Deallocate an array from allocate_bins
   LN*   copy_list            (LN*   l)                   const;  //Copy the elements in a bin (order irrelevant)
-  LN**  copy_hash_table      (LN** ht, int bins)         const;  //Copy the bins/keys/values in ht tree (order in bins irrelevant)
+  LN**  copy_hash_table      (LN** ht, std::size_t bins);  //Copy the bins/keys/values in ht tree (order in bins irrelevant)
+
+  void  ensure_load_threshold(std::size_t new_used);               //Reallocate if load_threshold > load_threshold
+  void  rehash               (std::size_t new_bins);               //Move every node into new_bins bins
+  void  delete_hash_table    (LN**& ht, std::size_t bins);               //Deallocate all LN in ht (and the ht itself; ht == nullptr)
 
-  void  ensure_load_threshold(int new_used);                     //Reallocate if load_threshold > load_threshold
-  void  delete_hash_table    (LN**& ht, int bins);               //Deallocate all LN in ht (and the ht itself; ht == nullptr)
+  std::size_t bulk_insert    (const std::vector<const T*>& elements, int workers);  //insert_all on workers threads
+  void  destroy_hash_table   (LN**& ht, std::size_t bins);               //Like delete_hash_table, but leaves the memory to pool.release_all
 };
 
 
@@ -171,63 +290,55 @@ private:
 //
 //Destructor/Constructors
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 HashSet<T,thash>::~HashSet() {
-    delete_hash_table(set,bins);
+    destroy_hash_table(set,bins);
 }
 
-template<class T, int (*thash)(const T& a)>
-HashSet<T,thash>::HashSet(double the_load_threshold, int (*chash)(const T& element))
-: hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash>::HashSet(double the_load_threshold, hash_t<T> (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold){
     if (hash == nullptr)
         throw TemplateFunctionError("default constructor: neither specified");
-    if (thash != nullptr && chash != nullptr && chash != thash)
+    if (thash != undefinedhash<T> && chash != nullptr && chash != thash)
         throw TemplateFunctionError("both given but different");
-    set = new LN*[bins];
-    for (int i =0; i <bins; ++i)
-        set[i] = new LN();
+    set = allocate_bins(bins);
 }
 
 
-template<class T, int (*thash)(const T& a)>
-HashSet<T,thash>::HashSet(int initial_bins, double the_load_threshold, int (*chash)(const T& element))
-: hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(initial_bins) {
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash>::HashSet(int initial_bins, double the_load_threshold, hash_t<T> (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
     if (hash == nullptr) {
         throw TemplateFunctionError("not specified");
     }
-    if (thash != nullptr && chash != nullptr && chash != thash) {
+    if (thash != undefinedhash<T> && chash != nullptr && chash != thash) {
         throw TemplateFunctionError("both given but different");
     }
-    if (bins == 0) {
-        bins = 1;
-    }
-    set = new LN*[bins];
-    for (int i =0; i <bins; ++i)
-        set[i] = new LN();
+    bins = bin_count<masked, std::size_t, hash_t<T>>(std::size_t(std::max(1, initial_bins)));
+    set = allocate_bins(bins);
 }
 
 
 
-template<class T, int (*thash)(const T& a)>
-HashSet<T,thash>::HashSet(const HashSet<T,thash>& to_copy, double the_load_threshold, int (*chash)(const T& element))
-: hash(thash != nullptr ? thash : chash), bins(to_copy.bins), load_threshold(the_load_threshold) {
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash>::HashSet(const HashSet<T,thash>& to_copy, double the_load_threshold, hash_t<T> (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), bins(to_copy.bins), load_threshold(the_load_threshold) {
     if (hash == nullptr) {
         hash = to_copy.hash;
     }
-    if (thash != nullptr && chash != nullptr && thash != chash) {
+    if (thash != undefinedhash<T> && chash != nullptr && thash != chash) {
         throw TemplateFunctionError("both specified and different");
     }
-    if (hash == to_copy.hash && to_copy.size() == size()) {
+    if (hash == to_copy.hash) {
         used = to_copy.used;
         set  = copy_hash_table(to_copy.set, to_copy.bins);
     }else {
-        bins = int(to_copy.size());
-        set = new LN*[bins];
-        for (int b=0; b<bins; ++b)
-            set[b] = new LN();
-        for (int i=0; i<to_copy.bins; i++) {
+        bins = bins_for(to_copy.size());
+        set = allocate_bins(bins);
+        for (std::size_t i=0; i<to_copy.bins; i++) {
             LN *temp = to_copy.set[i];
-            while (temp->next != nullptr) {
+            while (temp != nullptr) {
                 insert(temp->value);
                 temp = temp->next;
             }
@@ -236,65 +347,79 @@ HashSet<T,thash>::HashSet(const HashSet<T,thash>& to_copy, double the_load_thres
 }
 
 
-template<class T, int (*thash)(const T& a)>
-HashSet<T,thash>::HashSet(const std::initializer_list<T>& il, double the_load_threshold, int (*chash)(const T& element))
-: hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(std::max(1,int(il.size()/the_load_threshold))) {
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash>::HashSet(HashSet<T,thash>&& to_move)
+: hash(to_move.hash), load_threshold(to_move.load_threshold) {
+    set = allocate_bins(bins);
+    swap(to_move);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash>::HashSet(const std::initializer_list<T>& il, double the_load_threshold, hash_t<T> (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
     if (hash == nullptr) {
         throw TemplateFunctionError("neither specified");
     }
-    if (thash != nullptr && chash != nullptr && thash != chash) {
+    if (thash != undefinedhash<T> && chash != nullptr && thash != chash) {
         throw TemplateFunctionError("both specified and different");
     }
-    set = new LN* [bins];
-    for (int b=0; b<bins; ++b) {
-        set[b] = new LN();
-    }
-    for (const T& s_elem : il) {
-        insert(s_elem);
-    }
+    bins = bins_for(il.size());
+    set = allocate_bins(bins);
+    insert_all(il);
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 template<class Iterable>
-HashSet<T,thash>::HashSet(const Iterable& i, double the_load_threshold, int (*chash)(const T& a))
-: hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(std::max(1,int(i.size()/the_load_threshold))) {
+HashSet<T,thash>::HashSet(const Iterable& i, double the_load_threshold, hash_t<T> (*chash)(const T& a))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
     if (hash == nullptr)
         throw TemplateFunctionError("HashSet::Iterable constructor: neither specified");
-    if (thash != nullptr && chash != nullptr && thash != chash)
+    if (thash != undefinedhash<T> && chash != nullptr && thash != chash)
         throw TemplateFunctionError("HashSet::Iterable constructor: both specified and different");
 
-    set = new LN* [bins];
-    for (int b=0; b<bins; ++b)
-        set[b] = new LN();
-
-    for (const T& v : i)
-        insert(v);
+    bins = bins_for(i.size());
+    set = allocate_bins(bins);
+    insert_all(i);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 //Queries
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::empty() const {
     return used == 0;
 }
 
 
-template<class T, int (*thash)(const T& a)>
-int HashSet<T,thash>::size() const {
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::size() const {
     return used;
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::contains (const T& element) const {
     return find_element(element) != nullptr;
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
+template<class T2>
+bool HashSet<T,thash>::contains (const T2& element, hash_t<T> (*hash2)(const T2& k)) const {
+    return find_element(element, hash2(element)) != nullptr;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+auto HashSet<T,thash>::hash_function() const -> hashfunc {
+    return hash;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
 std::string HashSet<T,thash>::str() const {
     std::ostringstream answer;
     answer << "HashSet[]";
@@ -303,7 +428,7 @@ std::string HashSet<T,thash>::str() const {
 
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 template <class Iterable>
 bool HashSet<T,thash>::contains_all(const Iterable& i) const {
     for (const T& v : i)
@@ -313,19 +438,134 @@ bool HashSet<T,thash>::contains_all(const Iterable& i) const {
 }
 
 
+template<class T, hash_t<T> (*thash)(const T& a)>
+bool HashSet<T,thash>::contains_all(const HashSet<T,thash>& s) const {
+    return s.subset_of(*this);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash> HashSet<T,thash>::set_union(const HashSet<T,thash>& rhs) const {
+    //Copy the larger set (bin by bin, without hashing when the hash functions match), then add the smaller
+    const HashSet<T,thash>& larger  = (used >= rhs.used ? *this : rhs);
+    const HashSet<T,thash>& smaller = (used >= rhs.used ? rhs : *this);
+    HashSet<T,thash> answer(larger, load_threshold, hash);
+    answer.insert_all(smaller);
+    return answer;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash> HashSet<T,thash>::set_intersection(const HashSet<T,thash>& rhs) const {
+    const HashSet<T,thash>& larger  = (used >= rhs.used ? *this : rhs);
+    const HashSet<T,thash>& smaller = (used >= rhs.used ? rhs : *this);
+    HashSet<T,thash> answer(load_threshold, hash);
+    answer.reserve(smaller.used);
+    answer.visit_nodes(smaller, [&] (Worker& w, const LN* c) {
+        if (larger.contains_node(smaller, c))
+            answer.link_in(w, c->value, answer.hash_of(smaller, c));
+    });
+    return answer;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash> HashSet<T,thash>::set_difference(const HashSet<T,thash>& rhs) const {
+    HashSet<T,thash> answer(load_threshold, hash);
+    answer.reserve(used);
+    answer.visit_nodes(*this, [&] (Worker& w, const LN* c) {
+        if (!rhs.contains_node(*this, c))
+            answer.link_in(w, c->value, answer.hash_of(*this, c));
+    });
+    return answer;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash> HashSet<T,thash>::symmetric_difference(const HashSet<T,thash>& rhs) const {
+    HashSet<T,thash> answer(load_threshold, hash);
+    answer.reserve(used + rhs.used);
+    answer.visit_nodes(*this, [&] (Worker& w, const LN* c) {
+        if (!rhs.contains_node(*this, c))
+            answer.link_in(w, c->value, answer.hash_of(*this, c));
+    });
+    answer.visit_nodes(rhs, [&] (Worker& w, const LN* c) {
+        if (!contains_node(rhs, c))
+            answer.link_in(w, c->value, answer.hash_of(rhs, c));
+    });
+    return answer;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashStats HashSet<T,thash>::stats() const {
+    HashStats answer;
+    for (std::size_t i = 0; i < bins; ++i) {
+        std::size_t length = 0;
+        for (LN* c = set[i]; c != nullptr; c = c->next)
+            ++length;
+        count_chain(answer, length);
+    }
+    answer.size        = used;
+    answer.load_factor = double(used) / double(bins);
+    counters.fill(answer);
+    return answer;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::contains_batch(const T* elements, std::size_t n, bool* found) const {
+    int         hashes[BATCH];
+    std::size_t bin[BATCH];
+    LN*         head[BATCH];
+    std::size_t answer = 0;
+    for (std::size_t first = 0; first < n; first += BATCH) {
+        int count = int(std::min(std::size_t(BATCH), n - first));
+
+        //Hash every element in the group and prefetch its bin; then read the bins and prefetch their first nodes
+        for (int k = 0; k < count; ++k) {
+            hashes[k] = hash(elements[first+k]);
+            bin[k]    = hash_compress(hashes[k], bins);
+            prefetch(&set[bin[k]]);
+        }
+        for (int k = 0; k < count; ++k) {
+            head[k] = set[bin[k]];
+            prefetch(head[k]);
+        }
+
+        //Now search each chain, starting at a (probably) cached node
+        for (int k = 0; k < count; ++k) {
+            LN* c = head[k];
+            std::size_t walked = 0;
+            for (; c != nullptr; c = c->next) {
+                ++walked;
+                if (c->may_equal(hashes[k]) && elements[first+k] == c->value)
+                    break;
+            }
+            counters.lookup(walked, c != nullptr);
+            found[first+k] = (c != nullptr);
+            answer += found[first+k];
+        }
+    }
+    return answer;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //Commands
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 int HashSet<T,thash>::insert(const T& element) {
-    if (find_element(element) == nullptr)
+    hash_t<T> hashed = hash(element);
+    if (find_element(element, hashed) == nullptr)
     {
         ensure_load_threshold(used+1);
         ++used;
         ++mod_count;
-        int bin = hash_compress(element);
-        set[bin] = new LN(element, set[bin]);
+        std::size_t bin = hash_compress(hashed, bins);
+        set[bin] = make_node(element, set[bin]);
+        set[bin]->store(hashed);
         return 1;
     } else {
         return 0;
@@ -334,14 +574,43 @@ int HashSet<T,thash>::insert(const T& element) {
 }
 
 
+template<class T, hash_t<T> (*thash)(const T& a)>
+int HashSet<T,thash>::insert(T&& element) {
+    hash_t<T> hashed = hash(element);
+    if (find_element(element, hashed) != nullptr)
+        return 0;
+
+    ensure_load_threshold(used+1);
+    ++used;
+    ++mod_count;
+    std::size_t bin = hash_compress(hashed, bins);
+    set[bin] = make_node(std::move(element), set[bin]);
+    set[bin]->store(hashed);
+    return 1;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+template<class... Args>
+int HashSet<T,thash>::emplace(Args&&... args) {
+    return insert(T(std::forward<Args>(args)...));
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::reset_stats() {
+    counters.reset();
+}
+
+
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 int HashSet<T,thash>::erase(const T& element) {
-    LN* temp = find_element(element);
-    if (temp != nullptr) {
-        LN* to_delete = temp->next;
-        *temp = *temp->next;
-        delete to_delete;
+    LN** link = find_link(element);
+    if (link != nullptr) {
+        LN* to_delete = *link;
+        *link = to_delete->next;
+        recycle_node(to_delete);
         used--;
         mod_count++;
         return 1;
@@ -351,39 +620,73 @@ int HashSet<T,thash>::erase(const T& element) {
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 void HashSet<T,thash>::clear() {
-    int i = 0;
-    while (i < bins) {
-        LN* node = set[i];
-        while (node->next != nullptr) {
-            LN* to_delete = node;
-            node = node->next;
-            delete to_delete;
-        }
-        set[i] = node;
-        ++i;
-    }
+    //Give back all the pool's blocks at once
+    destroy_hash_table(set,bins);
+    pool.release_all();
+    small_nodes.forget_all();
+    set = allocate_bins(bins);
     used = 0;
     ++mod_count;
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::swap(HashSet<T,thash>& other) {
+    //Nodes in small_nodes cannot change sets, but their elements can move. If one set is empty (as in
+    //  a move) the other's move into its unused small_nodes, allocating nothing; otherwise both sets'
+    //  move into pool nodes.
+    if (used == 0)
+        other.evict_small_nodes(&small_nodes);
+    else if (other.used == 0)
+        evict_small_nodes(&other.small_nodes);
+    else {
+        evict_small_nodes();
+        other.evict_small_nodes();
+    }
+
+    std::swap(hash,           other.hash);
+    std::swap(set,            other.set);
+    std::swap(load_threshold, other.load_threshold);
+    std::swap(bins,           other.bins);
+    std::swap(used,           other.used);
+    pool.swap(other.pool);
+
+    //A swapped small_bin's contents move to the other set's small_bin, which its pointer must then use
+    std::swap(small_bin,      other.small_bin);
+    if (set == &other.small_bin)
+        set = &small_bin;
+    if (other.set == &small_bin)
+        other.set = &other.small_bin;
+    ++mod_count;
+    ++other.mod_count;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
 template<class Iterable>
-int HashSet<T,thash>::insert_all(const Iterable& i) {
-    int count = 0;
-    for (const T& v : i)
-        count += insert(v);
+std::size_t HashSet<T,thash>::insert_all(const Iterable& i) {
+    std::vector<const T*> elements;
+    std::vector<T>        copies;
+    gather(i, elements, copies);
+
+    int workers = parallel_workers(elements.size());
+    if (workers > 1)
+        return bulk_insert(elements, workers);
+
+    std::size_t count = 0;
+    for (const T* v : elements)
+        count += insert(*v);
 
     return count;
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 template<class Iterable>
-int HashSet<T,thash>::erase_all(const Iterable& i) {
-    int count = 0;
+std::size_t HashSet<T,thash>::erase_all(const Iterable& i) {
+    std::size_t count = 0;
     for (const T& v : i)
         count += erase(v);
 
@@ -391,11 +694,107 @@ int HashSet<T,thash>::erase_all(const Iterable& i) {
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 template<class Iterable>
-int HashSet<T,thash>::retain_all(const Iterable& i) {
+std::size_t HashSet<T,thash>::retain_all(const Iterable& i) {
+    HashSet<T,thash> keep(load_threshold, hash);
+    for (const T& v : i)
+        if (contains(v))
+            keep.insert(v);
+    return retain_all(keep);
+}
 
-    return used;
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::insert_all(const HashSet<T,thash>& s) {
+    if (this == &s)
+        return 0;
+
+    reserve(used + s.used);
+    return visit_nodes(s, [&] (Worker& w, const LN* c) {
+        hash_t<T> hashed = hash_of(s, c);
+        if (find_element(c->value, hashed) == nullptr)
+            link_in(w, c->value, hashed);
+    });
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::erase_all(const HashSet<T,thash>& s) {
+    if (this == &s) {
+        std::size_t count = used;
+        clear();
+        return count;
+    }
+
+    //Visit the smaller set's nodes
+    if (s.used < used)
+        return visit_nodes(s, [&] (Worker& w, const LN* c) {
+            LN** link = find_link(c->value, hash_of(s, c));
+            if (link != nullptr)
+                unlink_to(w, link);
+        });
+    return erase_nodes([&] (const LN* c) {return s.contains_node(*this, c);});
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::retain_all(const HashSet<T,thash>& s) {
+    if (this == &s)
+        return 0;
+    return erase_nodes([&] (const LN* c) {return !s.contains_node(*this, c);});
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::symmetric_difference_all(const HashSet<T,thash>& s) {
+    if (this == &s) {
+        std::size_t count = used;
+        clear();
+        return count;
+    }
+
+    //Toggle each of s's elements: erase it if it is here, insert it if not
+    reserve(used + s.used);
+    return visit_nodes(s, [&] (Worker& w, const LN* c) {
+        hash_t<T> hashed = hash_of(s, c);
+        LN** link = find_link(c->value, hashed);
+        if (link != nullptr)
+            unlink_to(w, link);
+        else
+            link_in(w, c->value, hashed);
+    });
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::save(const std::string& file_name) const {
+    typedef SetRecord<T> Record;
+    static_assert(std::is_trivially_copyable<T>::value, "HashSet::save: T must be trivially copyable");
+    std::vector<Record> records(used);
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < bins; ++i)
+        for (LN* c = set[i]; c != nullptr; c = c->next)
+            fill_record(records[n++], node_hash(c), c->value);
+    write_snapshot(file_name, SnapshotKind::set, sizeof(T), 0, records);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::load(const std::string& file_name) {
+    typedef SetRecord<T> Record;
+    static_assert(std::is_trivially_copyable<T>::value, "HashSet::load: T must be trivially copyable");
+    std::vector<Record> records = read_snapshot<Record>(file_name, SnapshotKind::set, sizeof(T), 0);
+    if (!records.empty() && hash(records[0].key) != records[0].hashed)
+        throw FileOpenError("HashSet::load: " + file_name + " was saved with a different hash function");
+
+    //The saved elements are distinct and carry their hash values: size set once, then just link nodes
+    clear();
+    reserve(records.size());
+    Worker w;
+    for (const Record& r : records)
+        link_in(w, r.key, r.hashed);
+    merge_workers(&w, 1);
 }
 
 
@@ -403,94 +802,71 @@ int HashSet<T,thash>::retain_all(const Iterable& i) {
 //
 //Operators
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 HashSet<T,thash>& HashSet<T,thash>::operator = (const HashSet<T,thash>& rhs) {
     if (this == &rhs)
         return *this;
 
+    clear();
+    for (const T& v : rhs)
+        insert(v);
     return *this;
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
+HashSet<T,thash>& HashSet<T,thash>::operator = (HashSet<T,thash>&& rhs) {
+    if (this != &rhs) {
+        clear();     //So swap moves rhs's small_nodes into this set's, without allocating
+        swap(rhs);
+    }
+    return *this;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::operator == (const HashSet<T,thash>& rhs) const {
     if (this == &rhs)
         return true;
-    if (used != rhs.size())
-        return false;
-    for (int i = 0; i < bins; i++) {
-        LN *temp = set[i];
-        while (temp -> next != nullptr) {
-            if (!rhs.contains(temp -> value)) {
-                return false;
-            }
-            temp = temp -> next;
-        }
-
-    }
-    return true;
-    }
+    return used == rhs.used && subset_of(rhs);
+}
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::operator != (const HashSet<T,thash>& rhs) const {
     return !(*this == rhs);
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::operator <= (const HashSet<T,thash>& rhs) const {
     if (this == &rhs)
         return true;
-    if (used > rhs.size())
-         return false;
-
-    for (int i = 0; i <bins; ++i) {
-        LN* temp = set[i];
-        while( temp -> next != nullptr) {
-            if (!rhs.contains(temp ->value)) {
-                return false;
-            }
-            temp = temp -> next;
-        }
-    }
-    return true;
+    return subset_of(rhs);
 }
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::operator < (const HashSet<T,thash>& rhs) const {
     if (this == &rhs)
         return false;
-    if (used >= rhs.size())
-        return false;
-
-    for (int i = 0; i <bins; ++i) {
-        LN* temp = set[i];
-        while( temp -> next != nullptr) {
-            if (!rhs.contains(temp ->value)) {
-                return false;
-            }
-            temp = temp -> next;
-        }
-    }
-    return true;
+    return used < rhs.used && subset_of(rhs);
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::operator >= (const HashSet<T,thash>& rhs) const {
     return rhs <= *this;
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::operator > (const HashSet<T,thash>& rhs) const {
     return rhs < *this;
 }
 
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 std::ostream& operator << (std::ostream& outs, const HashSet<T,thash>& s) {
     outs << "set[]";
     return outs;
@@ -501,13 +877,13 @@ std::ostream& operator << (std::ostream& outs, const HashSet<T,thash>& s) {
 //
 //Iterator constructors
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 auto HashSet<T,thash>::begin () const -> HashSet<T,thash>::Iterator {
     return Iterator(const_cast<HashSet<T,thash>*>(this),true);
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 auto HashSet<T,thash>::end () const -> HashSet<T,thash>::Iterator {
     return Iterator(const_cast<HashSet<T,thash>*>(this),false);
 }
@@ -517,109 +893,416 @@ auto HashSet<T,thash>::end () const -> HashSet<T,thash>::Iterator {
 //
 //Private helper methods
 
-template<class T, int (*thash)(const T& a)>
-int HashSet<T,thash>::hash_compress (const T& element) const {
-    return abs(hash(element))%bins;
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::hash_compress (hash_t<T> hashed, std::size_t bins) const {
+    return hash_bin<masked>(hashed, bins);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::bins_for (std::size_t count) const {
+    if (count <= std::size_t(SMALL))
+        return 1;
+    return bin_count<masked, std::size_t, hash_t<T>>(std::size_t(std::min(double(max_bins<std::size_t, hash_t<T>>()), double(count) / load_threshold)));
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+hash_t<T> HashSet<T,thash>::node_hash (const LN* node) const {
+    return node->cached ? node->hashed() : hash(node->value);
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 typename HashSet<T,thash>::LN* HashSet<T,thash>::find_element (const T& element) const {
-    int bin = hash_compress(element);
-    for (LN* c = set[bin]; c->next != nullptr; c = c->next) {
-        if (element == c->value) {
+    return find_element(element, hash(element));
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+template<class T2>
+typename HashSet<T,thash>::LN* HashSet<T,thash>::find_element (const T2& element, hash_t<T> hashed) const {
+    std::size_t bin = hash_compress(hashed, bins);
+    std::size_t walked = 0;
+    for (LN* c = set[bin]; c != nullptr; c = c->next) {
+        ++walked;
+        if (c->may_equal(hashed) && element == c->value) {
+            counters.lookup(walked, true);
             return c;
         }
     }
+    counters.lookup(walked, false);
     return nullptr;
 }
 
-template<class T, int (*thash)(const T& a)>
-typename HashSet<T,thash>::LN* HashSet<T,thash>::copy_list (LN* l) const {
-    if (l == nullptr){
-        return nullptr;
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+typename HashSet<T,thash>::LN** HashSet<T,thash>::find_link (const T& element) {
+    return find_link(element, hash(element));
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+typename HashSet<T,thash>::LN** HashSet<T,thash>::find_link (const T& element, hash_t<T> hashed) {
+    std::size_t bin = hash_compress(hashed, bins);
+    for (LN** link = &set[bin]; *link != nullptr; link = &(*link)->next) {
+        if ((*link)->may_equal(hashed) && element == (*link)->value) {
+            return link;
+        }
+    }
+    return nullptr;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+hash_t<T> HashSet<T,thash>::hash_of (const HashSet<T,thash>& from, const LN* node) const {
+    return from.hash == hash ? from.node_hash(node) : hash(node->value);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+bool HashSet<T,thash>::contains_node (const HashSet<T,thash>& from, const LN* node) const {
+    return find_element(node->value, hash_of(from, node)) != nullptr;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+bool HashSet<T,thash>::subset_of (const HashSet<T,thash>& rhs) const {
+    if (used > rhs.used)
+        return false;
+    for (std::size_t i = 0; i < bins; ++i)
+        for (LN* c = set[i]; c != nullptr; c = c->next)
+            if (!rhs.contains_node(*this, c))
+                return false;
+    return true;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::reserve (std::size_t new_used) {
+    std::size_t wanted = bins_for(new_used);
+    if (wanted > bins)
+        rehash(wanted);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+template<class Erase>
+std::size_t HashSet<T,thash>::erase_nodes (Erase erase) {
+    //Each worker unlinks nodes from its own range of bins
+    int workers = parallel_workers(used);
+    std::unique_ptr<Worker[]> w(new Worker[workers]);
+    try {
+        parallel_ranges(workers, bins, [&] (int worker, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                for (LN** link = &set[i]; *link != nullptr; )
+                    if (erase(*link))
+                        unlink_to(w[worker], link);
+                    else
+                        link = &(*link)->next;
+        });
+    }catch (...) {
+        merge_workers(w.get(), workers);
+        throw;
+    }
+    return merge_workers(w.get(), workers);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+template<class Visit>
+std::size_t HashSet<T,thash>::visit_nodes (const HashSet<T,thash>& from, Visit visit) {
+    //Co-partition: with the same hash function and power-of-two bins, the low bits of a value's bin index
+    //  in from equal those of its bin index here (when both have at least parts bins). So the worker
+    //  visiting from's bins j with j % parts == p changes only this set's bins b with b % parts == p.
+    int workers = (masked && from.hash == hash && &from != this ? parallel_workers(from.used) : 1);
+    int parts   = 1;
+    while (std::size_t(parts) * 2 <= std::min(std::min(bins, from.bins), std::size_t(8 * workers)))
+        parts *= 2;
+    if (parts == 1)
+        workers = 1;
+
+    std::unique_ptr<Worker[]> w(new Worker[workers]);
+    try {
+        parallel_for(workers, parts, [&] (int worker, int part) {
+            for (std::size_t j = part; j < from.bins; j += parts)
+                for (LN* c = from.set[j]; c != nullptr; c = c->next)
+                    visit(w[worker], c);
+        });
+    }catch (...) {
+        merge_workers(w.get(), workers);
+        throw;
+    }
+    return merge_workers(w.get(), workers);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::link_in (Worker& w, const T& element, hash_t<T> hashed) {
+    std::size_t bin = hash_compress(hashed, bins);
+    set[bin] = w.pool.make(element, set[bin]);
+    set[bin]->store(hashed);
+    ++w.added;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::unlink_to (Worker& w, LN** link) {
+    LN* to_delete = *link;
+    *link = to_delete->next;
+    to_delete->next = w.erased;
+    w.erased = to_delete;
+    ++w.removed;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::merge_workers (Worker* w, int workers) {
+    std::size_t count = 0;
+    for (int i = 0; i < workers; ++i) {
+        pool.absorb(w[i].pool);
+        while (w[i].erased != nullptr) {
+            LN* to_delete = w[i].erased;
+            w[i].erased = to_delete->next;
+            recycle_node(to_delete);
+        }
+        used   = used + w[i].added - w[i].removed;
+        count += w[i].added + w[i].removed;
+    }
+    if (count > 0)
+        ++mod_count;
+    return count;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+template<class... Args>
+typename HashSet<T,thash>::LN* HashSet<T,thash>::make_node (Args&&... args) const {
+    LN* node = small_nodes.make(std::forward<Args>(args)...);
+    return node != nullptr ? node : pool.make(std::forward<Args>(args)...);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::recycle_node (LN* node) {
+    if (small_nodes.owns(node))
+        small_nodes.recycle(node);
+    else
+        pool.recycle(node);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::destroy_node (LN* node) {
+    if (small_nodes.owns(node))
+        small_nodes.recycle(node);
+    else
+        pool.destroy(node);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::evict_small_nodes (InlineNodes<LN,SMALL>* into) {
+    for (int i = 0; i < SMALL && !small_nodes.empty(); ++i) {
+        LN* node = small_nodes.at(i);
+        if (node == nullptr)
+            continue;
+
+        hash_t<T> hashed = node_hash(node);
+        LN** link = &set[hash_compress(hashed, bins)];
+        while (*link != node)
+            link = &(*link)->next;
+        //into is empty and has as many slots as small_nodes, so its make always succeeds
+        if (into != nullptr)
+            *link = into->make(std::move_if_noexcept(node->value), node->next);
+        else
+            *link = pool.make(std::move_if_noexcept(node->value), node->next);
+        (*link)->store(hashed);
+        small_nodes.recycle(node);
     }
-    if (l -> next == nullptr){
-        return new LN();
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+typename HashSet<T,thash>::LN** HashSet<T,thash>::allocate_bins (std::size_t count) {
+    if (count == 1) {
+        small_bin = nullptr;
+        return &small_bin;
     }
-    LN* to_return = new LN(l -> value, new LN());
-    LN* temp = l -> next;
-    while ( temp -> next != nullptr){
-        to_return = new LN(temp -> value, to_return);
-        temp = temp -> next;
+    return new LN*[count]();
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::free_bins (LN** ht) {
+    if (ht != &small_bin)
+        delete[] ht;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+typename HashSet<T,thash>::LN* HashSet<T,thash>::copy_list (LN* l) const {
+    LN* to_return = nullptr;
+    for (LN* temp = l; temp != nullptr; temp = temp -> next){
+        to_return = make_node(*temp, to_return);
     }
     return to_return;
 
 }
 
 
-template<class T, int (*thash)(const T& a)>
-typename HashSet<T,thash>::LN** HashSet<T,thash>::copy_hash_table (LN** ht, int bins) const {
-    LN** new_ht = new LN*[bins];
-    for (int i=0; i<bins; i++) {
+template<class T, hash_t<T> (*thash)(const T& a)>
+typename HashSet<T,thash>::LN** HashSet<T,thash>::copy_hash_table (LN** ht, std::size_t bins) {
+    LN** new_ht = allocate_bins(bins);
+    for (std::size_t i=0; i<bins; i++) {
         new_ht[i] = copy_list(ht[i]);
     }
     return new_ht;
 }
 
 
-template<class T, int (*thash)(const T& a)>
-void HashSet<T,thash>::ensure_load_threshold(int new_used) {
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::ensure_load_threshold(std::size_t new_used) {
     if (new_used > load_threshold * bins) {
-        LN **oldset = set;
-        int oldbins = bins;
-        bins = 2 * oldbins;
-        set = new LN *[bins];
-        for (int i = 0; i < bins; ++i)
-            set[i] = new LN();
-        for (int i = 0; i < oldbins; ++i) {
-            LN *c = oldset[i];
-            for (; c->next != nullptr;) {
-                int bin = hash_compress(c->value);
-                LN *to_move = c;
-                c = c->next;
-                to_move->next = set[bin];
-                set[bin] = to_move;
-            }
-            delete c;
+        //A small set keeps its 1 bin; once it outgrows it, go straight to the bins its elements need
+        if (bins == 1) {
+            reserve(new_used);
+            return;
         }
-
-        delete[] oldset;
+        //Doubling is capped (see max_bins), so 2 * bins never overflows: past it, the chains just grow
+        if (bins >= max_bins<std::size_t, hash_t<T>>()) {
+            return;
+        }
+        rehash(2 * bins);
     }
 
     return;
 }
 
 
-template<class T, int (*thash)(const T& a)>
-void HashSet<T,thash>::delete_hash_table (LN**& ht, int bins) {
-    for (int i=0; i<bins; ++i) {
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::rehash(std::size_t new_bins) {
+    auto start = counters.resize_start();
+    LN **oldset = set;
+    std::size_t oldbins = bins;
+    bins = new_bins;
+    set = allocate_bins(bins);
+    for (std::size_t i = 0; i < oldbins; ++i) {
+        LN *c = oldset[i];
+        for (; c != nullptr;) {
+            std::size_t bin = hash_compress(node_hash(c), bins);
+            LN *to_move = c;
+            c = c->next;
+            to_move->next = set[bin];
+            set[bin] = to_move;
+        }
+    }
+
+    free_bins(oldset);
+    counters.resize_end(start);
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::delete_hash_table (LN**& ht, std::size_t bins) {
+    for (std::size_t i=0; i<bins; ++i) {
         LN *temp = ht[i];
-        while (temp->next != nullptr) {
+        while (temp != nullptr) {
             LN *to_delete = temp;
             temp = temp->next;
-            delete to_delete;
+            recycle_node(to_delete);
         }
     }
-    delete[] ht;
+    free_bins(ht);
     ht = nullptr;
 }
 
 
+template<class T, hash_t<T> (*thash)(const T& a)>
+void HashSet<T,thash>::destroy_hash_table (LN**& ht, std::size_t bins) {
+    if (NodePool<LN>::needs_destroy)
+        for (std::size_t i=0; i<bins; ++i)
+            for (LN* temp = ht[i]; temp != nullptr; ) {
+                LN* to_destroy = temp;
+                temp = temp->next;
+                destroy_node(to_destroy);
+            }
+    free_bins(ht);
+    ht = nullptr;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t HashSet<T,thash>::bulk_insert (const std::vector<const T*>& elements, int workers) {
+    std::size_t n = elements.size();
+    mod_count++;
+
+    //Size set for every element up front, so no thread ever rehashes
+    reserve(used + n);
+
+    std::vector<hash_t<T>> hashes(n);
+    parallel_ranges(workers, n, [&] (int, std::size_t begin, std::size_t end) {
+        for (std::size_t j = begin; j < end; ++j)
+            hashes[j] = hash(*elements[j]);
+    });
+
+    //Each part is a range of consecutive bins, so the threads linking different parts never share a bin
+    int parts = int(std::min(bins, std::size_t(8 * workers)));
+    std::vector<std::size_t> order, starts;
+    parallel_partition(workers, n, parts, [&] (std::size_t j) {
+        return int(static_cast<unsigned long long>(hash_compress(hashes[j], bins)) * parts / bins);
+    }, order, starts);
+
+    std::unique_ptr<NodePool<LN>[]> pools(new NodePool<LN>[workers]);
+    std::vector<std::size_t> added(workers, 0);
+    auto absorb_pools = [&] () {
+        std::size_t count = 0;
+        for (int w = 0; w < workers; ++w) {
+            pool.absorb(pools[w]);
+            count += added[w];
+        }
+        used += count;
+        return count;
+    };
+    try {
+        parallel_for(workers, parts, [&] (int worker, int part) {
+            for (std::size_t k = starts[part]; k < starts[part+1]; ++k) {
+                const T& element = *elements[order[k]];
+                hash_t<T> hashed = hashes[order[k]];
+                std::size_t bin = hash_compress(hashed, bins);
+                LN* c = set[bin];
+                while (c != nullptr && !(c->may_equal(hashed) && element == c->value))
+                    c = c->next;
+                if (c == nullptr) {
+                    set[bin] = pools[worker].make(element, set[bin]);
+                    set[bin]->store(hashed);
+                    added[worker]++;
+                }
+            }
+        });
+    }catch (...) {
+        //Keep (and count) the elements linked so far before passing on the exception
+        absorb_pools();
+        throw;
+    }
+    return absorb_pools();
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //Iterator class definitions
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 void HashSet<T,thash>::Iterator::advance_cursors() {
-    if (current.second != nullptr && current.second->next != nullptr && current.second->next->next != nullptr) {
+    if (current.second != nullptr && current.second->next != nullptr) {
         current.second = current.second->next;
         return;
     }
-    for (int i = current.first + 1; i < ref_set->bins; ++i) {
-        if (ref_set->set[i]->next != nullptr) {
+    for (std::size_t i = std::size_t(current.first + 1); i < ref_set->bins; ++i) {
+        if (ref_set->set[i] != nullptr) {
             current.second = ref_set->set[i];
-            current.first = i;
+            current.first = std::ptrdiff_t(i);
             return;
         }
     }
@@ -628,10 +1311,10 @@ void HashSet<T,thash>::Iterator::advance_cursors() {
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 HashSet<T,thash>::Iterator::Iterator(HashSet<T,thash>* iterate_over, bool begin)
 : ref_set(iterate_over) {
-    current = ics::pair<int,LN*>(-1, nullptr);
+    current = Cursor(-1, nullptr);
     expected_mod_count = ref_set->mod_count;
     if (begin) {
         advance_cursors();
@@ -639,12 +1322,12 @@ HashSet<T,thash>::Iterator::Iterator(HashSet<T,thash>* iterate_over, bool begin)
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 HashSet<T,thash>::Iterator::~Iterator()
 {}
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 T HashSet<T,thash>::Iterator::erase() {
     if (expected_mod_count != ref_set->mod_count) {
         throw ConcurrentModificationError("HashSet::Iterator::erase");
@@ -655,25 +1338,28 @@ T HashSet<T,thash>::Iterator::erase() {
     if (current.second == nullptr) {
         throw CannotEraseError("HashSet::Iterator::erase Iterator cursor beyond data structure");
     }
+    //Unlink the node, then position current at the following node, which ++ will not skip
     can_erase = false;
     T returnentry = current.second->value;
     ref_set -> used --;
     ref_set -> mod_count++;
-    LN* to_delete = current.second->next;
-    *current.second = *(current.second->next);
+    LN** link = ref_set->find_link(returnentry);
+    LN* to_delete = *link;
+    *link = to_delete->next;
+    advance_cursors();
     expected_mod_count = ref_set->mod_count;
-    delete to_delete;
+    ref_set->recycle_node(to_delete);
     return returnentry;
 }
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 std::string HashSet<T,thash>::Iterator::str() const {
     std::ostringstream string;
     string << ref_set->str() << "(current=" << current.first << "/" << current.second << ",expected_mod_count=" << expected_mod_count << ",can_erase=" << can_erase << ")";
     return string.str();
 }
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 auto  HashSet<T,thash>::Iterator::operator ++ () -> HashSet<T,thash>::Iterator& {
     if (expected_mod_count != ref_set -> mod_count) {
         throw ConcurrentModificationError("HashSet::Iterator::operator ++");
@@ -681,9 +1367,6 @@ auto  HashSet<T,thash>::Iterator::operator ++ () -> HashSet<T,thash>::Iterator&
     if (current.second == nullptr) {
         return *this;
     }
-    if (current.second->next == nullptr) {
-        advance_cursors();
-    }
     if (can_erase) {
         advance_cursors();
     }
@@ -692,27 +1375,24 @@ auto  HashSet<T,thash>::Iterator::operator ++ () -> HashSet<T,thash>::Iterator&
 }
 
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 auto  HashSet<T,thash>::Iterator::operator ++ (int) -> HashSet<T,thash>::Iterator {
-    Iterator* to_return = new Iterator(*this);
     if (expected_mod_count != ref_set->mod_count) {
         throw ConcurrentModificationError("HashSet::Iterator::operator ++(int)");
     }
     if (current.second == nullptr) {
-        return *to_return;
-    }
-    if (current.second->next == nullptr) {
-        advance_cursors();
+        return *this;
     }
+    Iterator to_return(*this);
     if (can_erase) {
         advance_cursors();
     }
     can_erase = true;
-    return *to_return;
+    return to_return;
 }
 
 
-    template<class T, int (*thash)(const T& a)>
+    template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::Iterator::operator == (const HashSet<T,thash>::Iterator& rhs) const {
     const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
     if (rhsASI == 0) {
@@ -725,7 +1405,7 @@ bool HashSet<T,thash>::Iterator::operator == (const HashSet<T,thash>::Iterator&
     }
 }
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 bool HashSet<T,thash>::Iterator::operator != (const HashSet<T,thash>::Iterator& rhs) const {
     const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
     if (rhsASI == 0) {
@@ -738,7 +1418,7 @@ bool HashSet<T,thash>::Iterator::operator != (const HashSet<T,thash>::Iterator&
     }
 }
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 T& HashSet<T,thash>::Iterator::operator *() const {
     if (!can_erase) {
         throw IteratorPositionIllegal("Iterator illegal");
@@ -753,7 +1433,7 @@ T& HashSet<T,thash>::Iterator::operator *() const {
     }
 }
 
-template<class T, int (*thash)(const T& a)>
+template<class T, hash_t<T> (*thash)(const T& a)>
 T* HashSet<T,thash>::Iterator::operator ->() const {
     if (current.second == nullptr) {
         throw IteratorPositionIllegal("Iterator illegal");
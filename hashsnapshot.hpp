@@ -0,0 +1,212 @@
+#ifndef HASH_SNAPSHOT_HPP_
+#define HASH_SNAPSHOT_HPP_
+
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+#include "ics_exceptions.hpp"
+#include "hashing.hpp"
+
+
+namespace ics {
+
+
+//The binary snapshot format written by HashMap::save/HashSet::save, read back by their load methods,
+//  and served in place (from the mapped file) by MappedHashMap/MappedHashSet (see mappedhashmap.hpp).
+//
+//A file is a SnapshotHeader, then bins+1 uint64_t starts, then count records. Each record stores a
+//  key's hash value (an int, or a std::uint64_t when hash64<KEY>) and its bytes (and for a map, its
+//  value's bytes). The records are grouped by bin
+//  (bin = hash_bin<true>(hash value, bins), with bins a power of two), so the records in bin b are
+//  records[starts[b]..starts[b+1]-1]: a lookup reads one contiguous run, straight from the file.
+//Keys/values are stored as raw bytes, so only trivially copyable types can be saved, and a file can
+//  be read only on a machine with the same byte order and type layouts (both recorded in the header).
+//The stored hash values come from the saving container's hash function: a loading container must
+//  use the same one (load checks this on one record).
+//Files that are not snapshots, or whose version/layout does not match, raise FileOpenError.
+
+constexpr std::uint32_t snapshot_version = 2;
+constexpr std::uint32_t snapshot_order   = 0x01020304;   //Reads differently with the other byte order
+
+enum class SnapshotKind : std::uint32_t {map = 1, set = 2};
+
+
+class SnapshotHeader {
+  public:
+    char          magic[8];        //"ICSHASH" (with its '\0')
+    std::uint32_t version;         //snapshot_version
+    std::uint32_t byte_order;      //snapshot_order
+    std::uint32_t kind;            //SnapshotKind
+    std::uint32_t key_size;        //sizeof(KEY)
+    std::uint32_t value_size;      //sizeof(T); 0 for a set
+    std::uint32_t record_size;     //sizeof(record), including padding
+    std::uint32_t hash_size;       //sizeof(hash value): 4, or 8 when hash64<KEY>
+    std::uint64_t count;           //# records
+    std::uint64_t bins;            //# bins (a power of two)
+    std::uint64_t starts_offset;   //File offset of starts[0]
+    std::uint64_t records_offset;  //File offset of records[0] (aligned for the record type)
+};
+
+
+//The record types: trivially copyable when KEY and T are
+template<class KEY, class T>
+class MapRecord {
+  public:
+    hash_t<KEY> hashed;
+    KEY key;
+    T   value;
+};
+
+template<class T>
+class SetRecord {
+  public:
+    hash_t<T> hashed;
+    T   key;
+};
+
+
+//Set r's fields after zeroing all of r: its padding bytes are written to the file too, so they must
+//  not hold leftover memory (and the same contents must always produce the same file)
+template<class KEY, class T>
+void fill_record(MapRecord<KEY,T>& r, hash_t<KEY> hashed, const KEY& key, const T& value) {
+    std::memset(&r, 0, sizeof(r));
+    r.hashed = hashed;
+    r.key    = key;
+    r.value  = value;
+}
+
+template<class T>
+void fill_record(SetRecord<T>& r, hash_t<T> hashed, const T& key) {
+    std::memset(&r, 0, sizeof(r));
+    r.hashed = hashed;
+    r.key    = key;
+}
+
+
+//Returns the header for count records of type Record
+template<class Record>
+SnapshotHeader snapshot_header(SnapshotKind kind, std::uint32_t key_size, std::uint32_t value_size, std::uint64_t count) {
+    SnapshotHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "ICSHASH", 8);
+    h.version     = snapshot_version;
+    h.byte_order  = snapshot_order;
+    h.kind        = static_cast<std::uint32_t>(kind);
+    h.key_size    = key_size;
+    h.value_size  = value_size;
+    h.record_size = sizeof(Record);
+    h.hash_size   = sizeof(Record::hashed);
+    h.count       = count;
+    h.bins        = bin_count<true, std::uint64_t, decltype(Record::hashed)>(count);
+    h.starts_offset  = sizeof(SnapshotHeader);
+    std::uint64_t end_starts = h.starts_offset + (h.bins + 1) * sizeof(std::uint64_t);
+    std::uint64_t align      = alignof(Record);
+    h.records_offset = (end_starts + align - 1) / align * align;
+    return h;
+}
+
+
+//Raises FileOpenError unless h (read from a file_size byte file) heads a snapshot of kind with this layout
+template<class Record>
+void check_snapshot(const SnapshotHeader& h, std::uint64_t file_size, const std::string& file_name,
+                    SnapshotKind kind, std::uint32_t key_size, std::uint32_t value_size) {
+    if (std::memcmp(h.magic, "ICSHASH", 8) != 0){
+        throw FileOpenError("snapshot " + file_name + ": not a HashMap/HashSet snapshot");
+    }
+    if (h.version != snapshot_version){
+        throw FileOpenError("snapshot " + file_name + ": version " + std::to_string(h.version) + " (expected " + std::to_string(snapshot_version) + ")");
+    }
+    if (h.byte_order != snapshot_order){
+        throw FileOpenError("snapshot " + file_name + ": saved with a different byte order");
+    }
+    if (h.kind != static_cast<std::uint32_t>(kind)){
+        throw FileOpenError("snapshot " + file_name + (kind == SnapshotKind::map ? ": holds a set, not a map" : ": holds a map, not a set"));
+    }
+    if (h.key_size != key_size or h.value_size != value_size or h.record_size != sizeof(Record)){
+        throw FileOpenError("snapshot " + file_name + ": key/value types do not match the saved ones");
+    }
+    if (h.hash_size != sizeof(Record::hashed)){
+        throw FileOpenError("snapshot " + file_name + ": saved with " + std::to_string(8 * h.hash_size) + "-bit hash values (expected " +
+                            std::to_string(8 * sizeof(Record::hashed)) + "; see hash64)");
+    }
+    //The starts and records are read in place (see MappedHashMap), so both must be aligned in the file
+    if (h.bins == 0 or (h.bins & (h.bins - 1)) != 0 or h.bins > max_bins<std::uint64_t, decltype(Record::hashed)>() or
+        h.starts_offset % sizeof(std::uint64_t) != 0 or h.records_offset % alignof(Record) != 0 or
+        h.starts_offset + (h.bins + 1) * sizeof(std::uint64_t) > h.records_offset or
+        h.records_offset > file_size or h.count > (file_size - h.records_offset) / sizeof(Record)){
+        throw FileOpenError("snapshot " + file_name + ": corrupt or truncated");
+    }
+}
+
+
+//Writes records (in any order) to file_name as a snapshot; raises FileOpenError if it cannot be written
+template<class Record>
+void write_snapshot(const std::string& file_name, SnapshotKind kind, std::uint32_t key_size, std::uint32_t value_size,
+                    const std::vector<Record>& records) {
+    static_assert(std::is_trivially_copyable<Record>::value, "snapshots hold only trivially copyable keys/values");
+
+    SnapshotHeader h = snapshot_header<Record>(kind, key_size, value_size, records.size());
+
+    //Counting sort of the records by bin; copying their bytes keeps the padding fill_record zeroed
+    std::vector<std::uint64_t> starts(h.bins + 1, 0);
+    for (const Record& r : records){
+        starts[hash_bin<true>(r.hashed, h.bins) + 1]++;
+    }
+    for (std::uint64_t b = 0; b < h.bins; b++){
+        starts[b + 1] += starts[b];
+    }
+    std::vector<std::uint64_t> next(starts.begin(), starts.end() - 1);
+    std::vector<Record> sorted(records.size());
+    for (const Record& r : records){
+        std::memcpy(&sorted[next[hash_bin<true>(r.hashed, h.bins)]++], &r, sizeof(Record));
+    }
+
+    std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+    if (!out){
+        throw FileOpenError("snapshot " + file_name + ": cannot open for writing");
+    }
+    static const char padding[alignof(Record) > 8 ? alignof(Record) : 8] = {};
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(starts.data()), starts.size() * sizeof(std::uint64_t));
+    out.write(padding, h.records_offset - (h.starts_offset + starts.size() * sizeof(std::uint64_t)));
+    out.write(reinterpret_cast<const char*>(sorted.data()), sorted.size() * sizeof(Record));
+    out.close();
+    if (!out){
+        throw FileOpenError("snapshot " + file_name + ": write failed");
+    }
+}
+
+
+//Returns the records in snapshot file_name (grouped by bin); raises FileOpenError if it cannot be read,
+//  or does not match (see check_snapshot)
+template<class Record>
+std::vector<Record> read_snapshot(const std::string& file_name, SnapshotKind kind, std::uint32_t key_size, std::uint32_t value_size) {
+    static_assert(std::is_trivially_copyable<Record>::value, "snapshots hold only trivially copyable keys/values");
+
+    std::ifstream in(file_name, std::ios::binary);
+    if (!in){
+        throw FileOpenError("snapshot " + file_name + ": cannot open for reading");
+    }
+    SnapshotHeader h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))){
+        throw FileOpenError("snapshot " + file_name + ": too short for a header");
+    }
+    in.seekg(0, std::ios::end);
+    std::uint64_t size = static_cast<std::uint64_t>(in.tellg());
+    check_snapshot<Record>(h, size, file_name, kind, key_size, value_size);
+
+    std::vector<Record> records(h.count);
+    in.seekg(h.records_offset);
+    if (!in.read(reinterpret_cast<char*>(records.data()), h.count * sizeof(Record))){
+        throw FileOpenError("snapshot " + file_name + ": read failed");
+    }
+    return records;
+}
+
+}
+
+#endif /* HASH_SNAPSHOT_HPP_ */
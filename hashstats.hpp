@@ -0,0 +1,163 @@
+#ifndef HASH_STATS_HPP_
+#define HASH_STATS_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace ics {
+
+
+//Statistics for the chained tables (HashMap/HashSet), returned by their stats() methods.
+//
+//The shape of the table (bins, occupancy, chain lengths) is measured when stats() is called, so it
+//  is always available. The activity counters (lookups, nodes walked, resizes) are updated only when
+//  ICS_HASH_STATS is defined before hashstats.hpp is first included (define it the same way in every
+//  file of a program); otherwise they stay 0 and cost nothing.
+//Telling the causes of slow lookups apart: with a good hash function the longest chain stays short
+//  (a few nodes) and occupancy matches load_factor; a bad hash function shows as a few long chains
+//  next to many empty bins, at the same load_factor.
+class HashStats {
+  public:
+    //Shape
+    std::size_t size          = 0;   //# keys/elements
+    std::size_t bins          = 0;   //# bins (including any still being migrated by an incremental rehash)
+    double      load_factor   = 0;   //size/bins
+    std::size_t empty_bins    = 0;   //# bins with no nodes
+    std::size_t longest_chain = 0;   //# nodes in the fullest bin
+    std::vector<std::size_t> occupancy;  //occupancy[k] = # bins holding exactly k nodes (k <= longest_chain)
+
+    //Activity (counted only with ICS_HASH_STATS)
+    std::uint64_t lookups       = 0;   //# searches of a chain for a key (by queries, and by puts/inserts)
+    std::uint64_t hits          = 0;   //# lookups that found their key
+    std::uint64_t misses        = 0;   //# lookups that did not
+    std::uint64_t nodes_walked  = 0;   //# nodes examined by all lookups
+    std::uint64_t longest_walk  = 0;   //Most nodes examined by one lookup
+    std::uint64_t resizes       = 0;   //# times the bins were reallocated (grown, shrunk, or reserved)
+    double        resize_seconds = 0;  //Total time spent reallocating bins and moving nodes into them
+
+    double mean_walk () const {return lookups == 0 ? 0.0 : double(nodes_walked) / double(lookups);}
+    double hit_rate  () const {return lookups == 0 ? 0.0 : double(hits) / double(lookups);}
+
+    //Returns the statistics as text: one "name: value" per line, then one line per nonempty occupancy[k]
+    std::string str () const;
+};
+
+
+std::ostream& operator << (std::ostream& outs, const HashStats& s);
+
+
+//HashCounters is the activity part of HashStats, kept inside a table. The counters are atomic
+//  (relaxed), so const lookups on several threads (e.g., in the parallel bulk operations) may count
+//  at once. They belong to one table object: copying, moving, or swapping tables does not copy them.
+#ifdef ICS_HASH_STATS
+class HashCounters {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    HashCounters () = default;
+    HashCounters (const HashCounters&) {}
+    HashCounters& operator = (const HashCounters&) {return *this;}
+
+    void lookup (std::size_t walked, bool hit) const {
+        lookups.fetch_add(1, std::memory_order_relaxed);
+        (hit ? hits : misses).fetch_add(1, std::memory_order_relaxed);
+        nodes_walked.fetch_add(walked, std::memory_order_relaxed);
+        std::uint64_t longest = longest_walk.load(std::memory_order_relaxed);
+        while (walked > longest and !longest_walk.compare_exchange_weak(longest, walked, std::memory_order_relaxed)){
+            //A failed exchange reloads longest: retry while walked is still longer
+        }
+    }
+
+    Clock::time_point resize_start () const {return Clock::now();}
+    void resize_end (Clock::time_point start) const {
+        resizes.fetch_add(1, std::memory_order_relaxed);
+        resize_nanos.fetch_add(std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()),
+                               std::memory_order_relaxed);
+    }
+
+    void fill (HashStats& s) const {
+        s.lookups        = lookups.load(std::memory_order_relaxed);
+        s.hits           = hits.load(std::memory_order_relaxed);
+        s.misses         = misses.load(std::memory_order_relaxed);
+        s.nodes_walked   = nodes_walked.load(std::memory_order_relaxed);
+        s.longest_walk   = longest_walk.load(std::memory_order_relaxed);
+        s.resizes        = resizes.load(std::memory_order_relaxed);
+        s.resize_seconds = double(resize_nanos.load(std::memory_order_relaxed)) * 1e-9;
+    }
+
+    void reset () {
+        for (std::atomic<std::uint64_t>* c : {&lookups, &hits, &misses, &nodes_walked, &longest_walk, &resizes, &resize_nanos}){
+            c -> store(0, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    mutable std::atomic<std::uint64_t> lookups{0}, hits{0}, misses{0}, nodes_walked{0}, longest_walk{0};
+    mutable std::atomic<std::uint64_t> resizes{0}, resize_nanos{0};
+};
+#else
+//Without ICS_HASH_STATS every call is empty, so the compiler removes the counting entirely
+class HashCounters {
+  public:
+    struct Clock {struct time_point {};};
+
+    void lookup (std::size_t, bool) const {}
+    Clock::time_point resize_start () const {return Clock::time_point();}
+    void resize_end (Clock::time_point) const {}
+    void fill (HashStats&) const {}
+    void reset () {}
+};
+#endif
+
+
+//Adds one chain of length nodes to s's shape
+inline void count_chain (HashStats& s, std::size_t length) {
+    if (length >= s.occupancy.size()){
+        s.occupancy.resize(length + 1, 0);
+    }
+    s.occupancy[length]++;
+    s.bins++;
+    s.empty_bins += (length == 0);
+    if (length > s.longest_chain){
+        s.longest_chain = length;
+    }
+}
+
+
+inline std::string HashStats::str () const {
+    std::ostringstream answer;
+    answer << "size: "           << size          << std::endl
+           << "bins: "           << bins          << std::endl
+           << "load_factor: "    << load_factor   << std::endl
+           << "empty_bins: "     << empty_bins    << std::endl
+           << "longest_chain: "  << longest_chain << std::endl
+           << "lookups: "        << lookups       << std::endl
+           << "hits: "           << hits          << std::endl
+           << "misses: "         << misses        << std::endl
+           << "mean_walk: "      << mean_walk()   << std::endl
+           << "longest_walk: "   << longest_walk  << std::endl
+           << "resizes: "        << resizes       << std::endl
+           << "resize_seconds: " << resize_seconds << std::endl;
+    for (std::size_t k = 0; k < occupancy.size(); k++){
+        if (occupancy[k] != 0){
+            answer << "occupancy[" << k << "]: " << occupancy[k] << std::endl;
+        }
+    }
+    return answer.str();
+}
+
+
+inline std::ostream& operator << (std::ostream& outs, const HashStats& s) {
+    return outs << s.str();
+}
+
+}
+
+#endif /* HASH_STATS_HPP_ */
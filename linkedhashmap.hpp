@@ -0,0 +1,1041 @@
+#ifndef LINKED_HASH_MAP_HPP_
+#define LINKED_HASH_MAP_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <initializer_list>
+#include <functional>
+#include <cstddef>
+#include <utility>
+#include "ics_exceptions.hpp"
+#include "pair.hpp"
+#include "nodepool.hpp"
+#include "hashing.hpp"
+
+
+namespace ics {
+
+
+//LinkedHashMap chains its bins like HashMap, and also threads every node on one doubly linked list
+//  that gives the iteration order: insertion order (the default), or, after set_access_order(true),
+//  access order (least recently used first). Both links are in the same node, so a lookup that
+//  moves its key to the back of the order finds it with one hash and one chain walk, and no
+//  allocation: the order costs two pointers per node.
+//With set_capacity(n) (or as an LRUCache, below) an insertion that makes size() exceed n erases the
+//  eldest entry (front()), first calling the eviction callback with its key and value.
+//
+//Which operations touch (move a key to the back, in access order): get, put, operator [] (non-const),
+//  and try_emplace/insert_or_assign. Queries (has_key, const operator [], front/back, iteration)
+//  never do. A touch that moves a key is a modification: iterators in progress become invalid.
+//
+//Instantiate the templated class supplying thash(a): produces a hash value for a.
+//If thash is defaulted to undefinedhash in the template, then a constructor must supply chash.
+//If both thash and chash are supplied, then they must be the same (by ==) function.
+//If neither is supplied, or both are supplied but different, TemplateFunctionError is raised.
+//The (unique) non-undefinedhash value supplied by thash/chash is stored in the instance variable hash.
+template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class LinkedHashMap {
+  public:
+    typedef ics::pair<KEY,T>   Entry;
+    typedef int (*hashfunc) (const KEY& a);
+
+    //Called with the key and value of each entry evicted to stay within capacity (it may move the
+    //  value out). It must not use the map it is evicted from.
+    typedef std::function<void(const KEY& key, T& value)> Evict;
+
+    //Destructor/Constructors
+    ~LinkedHashMap ();
+
+    LinkedHashMap          (double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+    explicit LinkedHashMap (int initial_bins, double the_load_threshold = 1.0, int (*chash)(const KEY& k) = nullptr);
+    LinkedHashMap          (const LinkedHashMap<KEY,T,thash>& to_copy, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+    LinkedHashMap          (LinkedHashMap<KEY,T,thash>&& to_move);  //to_move is left empty (with 1 bin)
+    explicit LinkedHashMap (const std::initializer_list<Entry>& il, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    explicit LinkedHashMap (const Iterable& i, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+
+
+    //Queries
+    bool empty      () const;
+    std::size_t size () const;
+    std::size_t capacity () const;           //The most entries kept (see set_capacity); 0 means unbounded
+    bool access_order () const;              //Whether the order is by access (else by insertion)
+    bool has_key    (const KEY& key) const;
+    bool has_value  (const T& value) const;
+    const Entry& front () const;             //The eldest entry (the next evicted); raises EmptyError if empty
+    const Entry& back  () const;             //The newest (or most recently used) entry; raises EmptyError if empty
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+    hashfunc    hash_function () const; //The hash function in use (thash or chash)
+
+
+    //Commands
+    T&   get   (const KEY& key);             //Touches key; raises KeyError if key is not in the map
+    T    put   (const KEY& key, const T& value);  //Touches key; a new key goes at the back
+    T    put   (KEY&& key, T&& value);           //Returns a copy of value if key was new (see HashMap::put)
+    T    erase (const KEY& key);
+    Entry pop_front ();                      //Erases and returns the eldest entry; raises EmptyError if empty
+    void clear ();
+    void swap  (LinkedHashMap<KEY,T,thash>& other);
+
+    //Like put, but without constructing a copy of the old value to return: true iff key was new
+    bool insert_or_assign (const KEY& key, const T& value);
+
+    //Constructs the value from args only if key is new; returns true iff it put. Touches key either way.
+    template <class... Args>
+    bool try_emplace (const KEY& key, Args&&... args);
+
+    //With access true, each touch moves its key to the back, so iteration runs from the least to the
+    //  most recently used key; with false (the default), keys stay in the order first put
+    void set_access_order (bool access);
+
+    //Keep at most entries key->value pairs (0 means unbounded): an insertion that exceeds it then
+    //  evicts the front entry, first calling on_evict (if any). Lowering the capacity evicts at once.
+    //If on_evict throws, that entry is not erased, and the exception propagates from the insertion
+    //  (which has already happened).
+    void set_capacity (std::size_t entries, Evict on_evict = nullptr);
+
+    //Grow now, so count entries fit without a rehash
+    void reserve (std::size_t count);
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    std::size_t put_all(const Iterable& i);
+
+
+    //Operators
+
+    T&       operator [] (const KEY&);       //Touches key (putting T() if key is new)
+    const T& operator [] (const KEY&) const;
+    LinkedHashMap<KEY,T,thash>& operator = (const LinkedHashMap<KEY,T,thash>& rhs);
+    LinkedHashMap<KEY,T,thash>& operator = (LinkedHashMap<KEY,T,thash>&& rhs);
+    bool operator == (const LinkedHashMap<KEY,T,thash>& rhs) const;   //Same key->value pairs (in any order)
+    bool operator != (const LinkedHashMap<KEY,T,thash>& rhs) const;
+
+    template<class KEY2,class T2, int (*hash2)(const KEY2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const LinkedHashMap<KEY2,T2,hash2>& m);
+
+
+
+  private:
+    class LN;
+
+  public:
+    //Iterators follow the order: front() first
+    class Iterator {
+      public:
+        //Private constructor called in begin/end, which are friends of LinkedHashMap<T>
+        ~Iterator();
+        Entry       erase();
+        std::string str  () const;
+        LinkedHashMap<KEY,T,thash>::Iterator& operator ++ ();
+        LinkedHashMap<KEY,T,thash>::Iterator  operator ++ (int);
+        bool operator == (const LinkedHashMap<KEY,T,thash>::Iterator& rhs) const;
+        bool operator != (const LinkedHashMap<KEY,T,thash>::Iterator& rhs) const;
+        Entry& operator *  () const;
+        Entry* operator -> () const;
+        friend std::ostream& operator << (std::ostream& outs, const LinkedHashMap<KEY,T,thash>::Iterator& i) {
+          outs << i.str(); //Use the same meaning as the debugging .str() method
+          return outs;
+        }
+        friend Iterator LinkedHashMap<KEY,T,thash>::begin () const;
+        friend Iterator LinkedHashMap<KEY,T,thash>::end   () const;
+
+      private:
+        //If can_erase is false, current is the node after the one erased (must ++ to reach it)
+        LN*                         current; //nullptr when exhausted
+        LinkedHashMap<KEY,T,thash>* ref_map;
+        int                         expected_mod_count;
+        bool                        can_erase = true;
+
+        //Called in friends begin/end
+        Iterator(LinkedHashMap<KEY,T,thash>* iterate_over, bool from_begin);
+    };
+
+
+    Iterator begin () const;
+    Iterator end   () const;
+
+
+  private:
+    //Unless cache_hash<KEY> is false, each LN also stores hash(value.first) (see hashing.hpp)
+    class LN : public HashCache<cache_hash<KEY>::value> {
+    public:
+      LN (const LN& ln) : HashCache<cache_hash<KEY>::value>(ln), value(ln.value){}
+
+      //Assign the members so that rvalue keys/values are moved into the node, not copied
+      template <class K, class V>
+      LN (K&& k, V&& v){
+        value.first  = std::forward<K>(k);
+        value.second = std::forward<V>(v);
+      }
+
+      Entry value;
+      LN*   next   = nullptr;   //In its bin's chain
+      LN*   before = nullptr;   //In the order: toward front()
+      LN*   after  = nullptr;   //In the order: toward back()
+  };
+
+  HashFunction<KEY,thash> hash; //Hashing function used (from template or constructor)
+  LN** map      = nullptr;    //Pointer to array of pointers: each bin stores a nullptr-terminated list (empty bins allocate nothing)
+  double load_threshold;      //used/bins <= load_threshold
+  std::size_t bins     = 1;   //# bins in array: >= 1, and a power of two when masked (see bin_count)
+  std::size_t used     = 0;   //Cache for number of key->value pairs in the hash table
+  int mod_count = 0;          //For sensing concurrent modification
+
+  LN* head = nullptr;         //front() of the order (nullptr when empty)
+  LN* tail = nullptr;         //back() of the order
+  bool by_access = false;     //Whether touches move keys to the back
+  std::size_t max_entries = 0;  //Evict beyond this many entries (0: never)
+  Evict evicted;              //Called for each evicted entry (if not empty)
+
+  NodePool<LN> pool;          //Allocates every LN in map
+
+  static constexpr bool masked = mask_bins<KEY>::value;     //bins is a power of two; hash_compress masks
+
+  //Helper methods
+  std::size_t hash_compress  (int hashed, std::size_t bins) const;  //hash value ranged to [0,bins-1]
+  std::size_t bins_for       (std::size_t count)        const;  //# bins (see bin_count) that count keys need at load_threshold
+  int   node_hash            (const LN* node)          const;  //hash(node's key), from the node if it caches it
+  LN*   find_key             (const KEY& key, int hashed) const;  //Returns key's node or nullptr
+  LN**  find_link            (const KEY& key);                 //Returns the pointer (bin or next) to key's node or nullptr
+  LN**  link_to              (const LN* node);                 //Same for a node in the map, found by identity (no key compares)
+
+  template <class K, class V>
+  LN*   link_new             (K&& key, V&& value, int hashed); //Put a node for absent key at the back (growing first); returns it
+  void  touch                (LN* node);                       //In access order, move node to the back
+  void  append               (LN* node);                       //Link node in at the back of the order
+  void  unorder              (LN* node);                       //Unlink node from the order
+  void  unlink_erase         (LN** link);                      //Unlink *link from its bin and the order, and recycle it
+  void  evict_excess         ();                               //Evict front entries while used > max_entries
+  void  copy_entries         (const LinkedHashMap<KEY,T,thash>& from);  //Put from's entries, in its order, into this (empty) map
+
+  void  ensure_load_threshold(std::size_t new_used);           //Grow if used/bins would exceed load_threshold
+  void  rehash               (std::size_t new_bins);           //Move every node into new_bins bins
+  void  delete_hash_table    (LN**& ht);                       //Destroy all LN in ht, then ht (ht == nullptr); empties the order
+};
+
+
+
+
+//An LRUCache is a LinkedHashMap in access order with a capacity: putting a new key into a full cache
+//  evicts the least recently used one (calling evicted, e.g., to write it back). Its bins grow with
+//  its entries, so a large capacity costs nothing until it is used: reserve(capacity) sizes them up
+//  front instead, so it never rehashes. A capacity of 0 means unbounded (see set_capacity).
+template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class LRUCache : public LinkedHashMap<KEY,T,thash> {
+  public:
+    typedef typename LinkedHashMap<KEY,T,thash>::Evict Evict;
+
+    explicit LRUCache (std::size_t capacity, Evict evicted = nullptr, double the_load_threshold = 1.0, int (*chash)(const KEY& a) = nullptr);
+};
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//LinkedHashMap class and related definitions
+
+//Destructor/Constructors
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::~LinkedHashMap() {
+    delete_hash_table(map);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::LinkedHashMap(double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("LinkedHashMap::default constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("LinkedHashMap::default constructor: both specified and different");
+    }
+    map = new LN* [bins]();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::LinkedHashMap(int initial_bins, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("LinkedHashMap::length constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("LinkedHashMap::length constructor: both specified and different");
+    }
+    bins = bin_count<masked>(std::size_t(std::max(1, initial_bins)));
+    map  = new LN* [bins]();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::LinkedHashMap(const LinkedHashMap<KEY,T,thash>& to_copy, double the_load_threshold, int (*chash)(const KEY& a))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        hash = to_copy.hash;
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("LinkedHashMap::copy constructor: both specified and different");
+    }
+    by_access   = to_copy.by_access;
+    max_entries = to_copy.max_entries;
+    evicted     = to_copy.evicted;
+    bins = bins_for(to_copy.used);
+    map  = new LN* [bins]();
+    copy_entries(to_copy);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::LinkedHashMap(LinkedHashMap<KEY,T,thash>&& to_move)
+:   hash(to_move.hash), load_threshold(to_move.load_threshold)
+{
+    map = new LN* [bins]();
+    swap(to_move);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::LinkedHashMap(const std::initializer_list<Entry>& il, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("LinkedHashMap::initializer_list constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("LinkedHashMap::initializer_list constructor: both specified and different");
+    }
+    bins = bins_for(il.size());
+    map  = new LN* [bins]();
+    put_all(il);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template <class Iterable>
+LinkedHashMap<KEY,T,thash>::LinkedHashMap(const Iterable& i, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("LinkedHashMap::Iterable constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("LinkedHashMap::Iterable constructor: both specified and different");
+    }
+    bins = bins_for(i.size());
+    map  = new LN* [bins]();
+    put_all(i);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Queries
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::empty() const {
+    return used == 0;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t LinkedHashMap<KEY,T,thash>::size() const {
+    return used;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t LinkedHashMap<KEY,T,thash>::capacity() const {
+    return max_entries;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::access_order() const {
+    return by_access;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::has_key (const KEY& key) const {
+    return find_key(key, hash(key)) != nullptr;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::has_value (const T& value) const {
+    for (LN* temp = head; temp != nullptr; temp = temp -> after){
+        if (temp -> value.second == value){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::front () const -> const Entry& {
+    if (head == nullptr){
+        throw EmptyError("LinkedHashMap::front");
+    }
+    return head -> value;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::back () const -> const Entry& {
+    if (tail == nullptr){
+        throw EmptyError("LinkedHashMap::back");
+    }
+    return tail -> value;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string LinkedHashMap<KEY,T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "LinkedHashMap[";
+    for (std::size_t i = 0; i < bins; i++){
+        answer << std::endl << "  bin[" << i << "]: ";
+        for (LN* temp = map[i]; temp != nullptr; temp = temp -> next){
+            answer << temp -> value.first << "->" << temp -> value.second << " ";
+        }
+    }
+    answer << std::endl << "  order: ";
+    for (LN* temp = head; temp != nullptr; temp = temp -> after){
+        answer << temp -> value.first << " ";
+    }
+    answer << "](used=" << used << ",bins=" << bins << ",access_order=" << by_access
+           << ",capacity=" << max_entries << ",mod_count=" << mod_count << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::hash_function () const -> hashfunc {
+    return hash;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Commands
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T& LinkedHashMap<KEY,T,thash>::get(const KEY& key) {
+    LN* temp = find_key(key, hash(key));
+    if (temp == nullptr){
+        std::ostringstream answer;
+        answer << "LinkedHashMap::get: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    touch(temp);
+    return temp -> value.second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T LinkedHashMap<KEY,T,thash>::put(const KEY& key, const T& value) {
+    int hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    mod_count++;
+    if (temp == nullptr){
+        //Return the new node's copy: value may be (a reference to) the value evict_excess erases
+        LN* added = link_new(key, value, hashed);
+        evict_excess();
+        return added -> value.second;
+    }
+    touch(temp);
+    //value may alias temp's own value (e.g., put(k, m[k])), so copy it before swapping it in
+    T xd = value;
+    std::swap(xd, temp -> value.second);
+    return xd;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T LinkedHashMap<KEY,T,thash>::put(KEY&& key, T&& value) {
+    int hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    mod_count++;
+    if (temp == nullptr){
+        T xd = link_new(std::move(key), std::move(value), hashed) -> value.second;
+        evict_excess();
+        return xd;
+    }
+    touch(temp);
+    T xd = std::move(temp -> value.second);
+    temp -> value.second = std::move(value);
+    return xd;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T LinkedHashMap<KEY,T,thash>::erase(const KEY& key) {
+    LN** link = find_link(key);
+    if (link == nullptr){
+        std::ostringstream answer;
+        answer << "LinkedHashMap::erase: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    T xd = std::move((*link) -> value.second);
+    unlink_erase(link);
+    mod_count++;
+    return xd;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::pop_front() -> Entry {
+    if (head == nullptr){
+        throw EmptyError("LinkedHashMap::pop_front");
+    }
+    LN** link = link_to(head);
+    Entry to_return = std::move(head -> value);
+    unlink_erase(link);
+    mod_count++;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::clear() {
+    delete_hash_table(map);
+    pool.release_all();
+    map  = new LN* [bins]();
+    used = 0;
+    mod_count++;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::swap(LinkedHashMap<KEY,T,thash>& other) {
+    std::swap(hash,           other.hash);
+    std::swap(map,            other.map);
+    std::swap(load_threshold, other.load_threshold);
+    std::swap(bins,           other.bins);
+    std::swap(used,           other.used);
+    std::swap(head,           other.head);
+    std::swap(tail,           other.tail);
+    std::swap(by_access,      other.by_access);
+    std::swap(max_entries,    other.max_entries);
+    std::swap(evicted,        other.evicted);
+    pool.swap(other.pool);
+    mod_count++;
+    other.mod_count++;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::insert_or_assign(const KEY& key, const T& value) {
+    int hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    mod_count++;
+    if (temp != nullptr){
+        touch(temp);
+        temp -> value.second = value;
+        return false;
+    }
+    link_new(key, value, hashed);
+    evict_excess();
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class... Args>
+bool LinkedHashMap<KEY,T,thash>::try_emplace(const KEY& key, Args&&... args) {
+    int hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    if (temp != nullptr){
+        touch(temp);
+        return false;
+    }
+    mod_count++;
+    link_new(key, T(std::forward<Args>(args)...), hashed);
+    evict_excess();
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::set_access_order(bool access) {
+    by_access = access;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::set_capacity(std::size_t entries, Evict on_evict) {
+    max_entries = entries;
+    evicted     = std::move(on_evict);
+    evict_excess();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::reserve(std::size_t count) {
+    std::size_t wanted = bins_for(count);
+    if (wanted > bins){
+        rehash(wanted);
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class Iterable>
+std::size_t LinkedHashMap<KEY,T,thash>::put_all(const Iterable& i) {
+    std::size_t count = 0;
+    for (const Entry& m_entry : i){
+        count++;
+        put(m_entry.first, m_entry.second);
+    }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Operators
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T& LinkedHashMap<KEY,T,thash>::operator [] (const KEY& key) {
+    int hashed = hash(key);
+    LN* temp = find_key(key, hashed);
+    if (temp != nullptr){
+        touch(temp);
+        return temp -> value.second;
+    }
+    mod_count++;
+    temp = link_new(key, T(), hashed);
+    evict_excess();   //Never evicts temp: it is at the back, and a capacity is at least 1
+    return temp -> value.second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+const T& LinkedHashMap<KEY,T,thash>::operator [] (const KEY& key) const {
+    LN* temp = find_key(key, hash(key));
+    if (temp == nullptr){
+        std::ostringstream answer;
+        answer << "LinkedHashMap::operator []: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return temp -> value.second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>& LinkedHashMap<KEY,T,thash>::operator = (const LinkedHashMap<KEY,T,thash>& rhs) {
+    if (this == &rhs){
+        return *this;
+    }
+    clear();
+    by_access   = rhs.by_access;
+    max_entries = rhs.max_entries;
+    evicted     = rhs.evicted;
+    reserve(rhs.used);
+    copy_entries(rhs);
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>& LinkedHashMap<KEY,T,thash>::operator = (LinkedHashMap<KEY,T,thash>&& rhs) {
+    if (this != &rhs){
+        swap(rhs);
+        rhs.clear();
+    }
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::operator == (const LinkedHashMap<KEY,T,thash>& rhs) const {
+    if (this == &rhs){
+        return true;
+    }
+    if (used != rhs.size()){
+        return false;
+    }
+    for (LN* temp = head; temp != nullptr; temp = temp -> after){
+        LN* other = rhs.find_key(temp -> value.first, rhs.hash(temp -> value.first));
+        if (other == nullptr or temp -> value.second != other -> value.second){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::operator != (const LinkedHashMap<KEY,T,thash>& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::ostream& operator << (std::ostream& outs, const LinkedHashMap<KEY,T,thash>& m) {
+    outs << "map[";
+    bool first = true;
+    for (const auto& m_entry : m){
+        outs << (first ? "" : ",") << m_entry.first << "->" << m_entry.second;
+        first = false;
+    }
+    outs << "]";
+    return outs;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator constructors
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::begin () const -> LinkedHashMap<KEY,T,thash>::Iterator {
+    return Iterator(const_cast<LinkedHashMap<KEY,T,thash>*>(this), true);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::end () const -> LinkedHashMap<KEY,T,thash>::Iterator {
+    return Iterator(const_cast<LinkedHashMap<KEY,T,thash>*>(this), false);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Private helper methods
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t LinkedHashMap<KEY,T,thash>::hash_compress (int hashed, std::size_t bins) const {
+    return hash_bin<masked>(hashed, bins);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::size_t LinkedHashMap<KEY,T,thash>::bins_for (std::size_t count) const {
+    return bin_count<masked>(std::size_t(std::min(double(max_bins<std::size_t>()), double(count) / load_threshold)));
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+int LinkedHashMap<KEY,T,thash>::node_hash (const LN* node) const {
+    return (node -> cached ? node -> hashed() : hash(node -> value.first));
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+typename LinkedHashMap<KEY,T,thash>::LN* LinkedHashMap<KEY,T,thash>::find_key (const KEY& key, int hashed) const {
+    for (LN* temp = map[hash_compress(hashed, bins)]; temp != nullptr; temp = temp -> next){
+        if (temp -> may_equal(hashed) and key == temp -> value.first){
+            return temp;
+        }
+    }
+    return nullptr;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+typename LinkedHashMap<KEY,T,thash>::LN** LinkedHashMap<KEY,T,thash>::find_link (const KEY& key) {
+    int hashed = hash(key);
+    for (LN** link = &map[hash_compress(hashed, bins)]; *link != nullptr; link = &(*link) -> next){
+        if ((*link) -> may_equal(hashed) and key == (*link) -> value.first){
+            return link;
+        }
+    }
+    return nullptr;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+typename LinkedHashMap<KEY,T,thash>::LN** LinkedHashMap<KEY,T,thash>::link_to (const LN* node) {
+    LN** link = &map[hash_compress(node_hash(node), bins)];
+    while (*link != node){
+        link = &(*link) -> next;
+    }
+    return link;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class K, class V>
+typename LinkedHashMap<KEY,T,thash>::LN* LinkedHashMap<KEY,T,thash>::link_new (K&& key, V&& value, int hashed) {
+    ensure_load_threshold(used + 1);
+    LN* node = pool.make(std::forward<K>(key), std::forward<V>(value));
+    node -> store(hashed);
+    std::size_t bin = hash_compress(hashed, bins);
+    node -> next = map[bin];
+    map[bin] = node;
+    append(node);
+    used++;
+    return node;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::touch (LN* node) {
+    if (by_access and node != tail){
+        unorder(node);
+        append(node);
+        mod_count++;
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::append (LN* node) {
+    node -> before = tail;
+    node -> after  = nullptr;
+    (tail == nullptr ? head : tail -> after) = node;
+    tail = node;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::unorder (LN* node) {
+    (node -> before == nullptr ? head : node -> before -> after) = node -> after;
+    (node -> after  == nullptr ? tail : node -> after -> before) = node -> before;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::unlink_erase (LN** link) {
+    LN* to_delete = *link;
+    *link = to_delete -> next;
+    unorder(to_delete);
+    pool.recycle(to_delete);
+    used--;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::evict_excess () {
+    while (max_entries > 0 and used > max_entries){
+        if (evicted){
+            evicted(head -> value.first, head -> value.second);
+        }
+        unlink_erase(link_to(head));
+        mod_count++;
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::copy_entries (const LinkedHashMap<KEY,T,thash>& from) {
+    for (LN* temp = from.head; temp != nullptr; temp = temp -> after){
+        int hashed = (hash == from.hash ? from.node_hash(temp) : hash(temp -> value.first));
+        if (hash == from.hash){
+            link_new(temp -> value.first, temp -> value.second, hashed);   //from's keys are distinct
+        }
+        else if (find_key(temp -> value.first, hashed) == nullptr){
+            link_new(temp -> value.first, temp -> value.second, hashed);
+        }
+    }
+    mod_count++;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::ensure_load_threshold(std::size_t new_used) {
+    if (double(new_used) / double(bins) > load_threshold){
+        //Doubling is capped (see max_bins), so bins * 2 never overflows: past it, the chains just grow
+        if (bins >= max_bins<std::size_t>()){
+            return;
+        }
+        rehash(bins * 2);
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::rehash(std::size_t new_bins) {
+    //The order list is untouched: relink each node into its new bin, following the order
+    delete[] map;
+    map  = new LN* [new_bins]();
+    bins = new_bins;
+    for (LN* temp = head; temp != nullptr; temp = temp -> after){
+        std::size_t bin = hash_compress(node_hash(temp), bins);
+        temp -> next = map[bin];
+        map[bin] = temp;
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void LinkedHashMap<KEY,T,thash>::delete_hash_table (LN**& ht) {
+    if (NodePool<LN>::needs_destroy){
+        for (LN* temp = head; temp != nullptr; ){
+            LN* to_destroy = temp;
+            temp = temp -> after;
+            pool.destroy(to_destroy);
+        }
+    }
+    head = tail = nullptr;
+    delete[] ht;
+    ht = nullptr;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator class definitions
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::Iterator::Iterator(LinkedHashMap<KEY,T,thash>* iterate_over, bool from_begin)
+        : current(from_begin ? iterate_over -> head : nullptr), ref_map(iterate_over), expected_mod_count(ref_map->mod_count) {
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LinkedHashMap<KEY,T,thash>::Iterator::~Iterator()
+{}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::Iterator::erase() -> Entry {
+    if (expected_mod_count != ref_map -> mod_count){
+        throw ConcurrentModificationError("LinkedHashMap::Iterator::erase");
+    }
+    if (!can_erase){
+        throw CannotEraseError("LinkedHashMap::Iterator::erase Iterator cursor already erased");
+    }
+    if (current == nullptr){
+        throw CannotEraseError("LinkedHashMap::Iterator::erase Iterator cursor beyond data structure");
+    }
+
+    //Position current at the following node (which ++ will not skip), then unlink the erased one
+    can_erase = false;
+    LN* to_delete = current;
+    Entry to_return = current -> value;
+    current = current -> after;
+    ref_map -> unlink_erase(ref_map -> link_to(to_delete));
+    ref_map -> mod_count++;
+    expected_mod_count = ref_map -> mod_count;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string LinkedHashMap<KEY,T,thash>::Iterator::str() const {
+    std::ostringstream answer;
+    answer << ref_map -> str() << "(current=";
+    if (current == nullptr){
+        answer << "end";
+    }
+    else{
+        answer << current -> value.first;
+    }
+    answer << ",expected_mod_count=" << expected_mod_count << ",can_erase=" << can_erase << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::Iterator::operator ++ () -> LinkedHashMap<KEY,T,thash>::Iterator& {
+    if (expected_mod_count != ref_map -> mod_count){
+        throw ConcurrentModificationError("LinkedHashMap::Iterator::operator ++");
+    }
+    if (current == nullptr){
+        return *this;
+    }
+    if (can_erase){
+        current = current -> after;
+    }
+    can_erase = true;
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto LinkedHashMap<KEY,T,thash>::Iterator::operator ++ (int) -> LinkedHashMap<KEY,T,thash>::Iterator {
+    if (expected_mod_count != ref_map -> mod_count){
+        throw ConcurrentModificationError("LinkedHashMap::Iterator::operator ++(int)");
+    }
+    if (current == nullptr){
+        return *this;
+    }
+    Iterator to_return(*this);
+    if (can_erase){
+        current = current -> after;
+    }
+    can_erase = true;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::Iterator::operator == (const LinkedHashMap<KEY,T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("LinkedHashMap::Iterator::operator ==");
+    }
+    if (expected_mod_count != ref_map -> mod_count){
+        throw ConcurrentModificationError("LinkedHashMap::Iterator::operator ==");
+    }
+    if (ref_map != rhsASI -> ref_map){
+        throw ComparingDifferentIteratorsError("LinkedHashMap::Iterator::operator ==");
+    }
+    return current == rhsASI -> current;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool LinkedHashMap<KEY,T,thash>::Iterator::operator != (const LinkedHashMap<KEY,T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("LinkedHashMap::Iterator::operator !=");
+    }
+    if (expected_mod_count != ref_map -> mod_count){
+        throw ConcurrentModificationError("LinkedHashMap::Iterator::operator !=");
+    }
+    if (ref_map != rhsASI -> ref_map){
+        throw ComparingDifferentIteratorsError("LinkedHashMap::Iterator::operator !=");
+    }
+    return current != rhsASI -> current;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+pair<KEY,T>& LinkedHashMap<KEY,T,thash>::Iterator::operator *() const {
+    if (expected_mod_count != ref_map -> mod_count){
+        throw ConcurrentModificationError("LinkedHashMap::Iterator::operator *");
+    }
+    if (!can_erase or current == nullptr){
+        throw IteratorPositionIllegal("LinkedHashMap::Iterator::operator * Iterator illegal: exhausted");
+    }
+    return current -> value;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+pair<KEY,T>* LinkedHashMap<KEY,T,thash>::Iterator::operator ->() const {
+    if (expected_mod_count != ref_map -> mod_count){
+        throw ConcurrentModificationError("LinkedHashMap::Iterator::operator ->");
+    }
+    if (!can_erase or current == nullptr){
+        throw IteratorPositionIllegal("LinkedHashMap::Iterator::operator -> Iterator illegal: exhausted");
+    }
+    return &(current -> value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//LRUCache class definitions
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+LRUCache<KEY,T,thash>::LRUCache(std::size_t capacity, Evict evicted, double the_load_threshold, int (*chash)(const KEY& a))
+:   LinkedHashMap<KEY,T,thash>(the_load_threshold, chash) {
+    this -> set_access_order(true);
+    this -> set_capacity(capacity, std::move(evicted));
+}
+
+}
+
+#endif /* LINKED_HASH_MAP_HPP_ */
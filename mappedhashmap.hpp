@@ -0,0 +1,335 @@
+#ifndef MAPPED_HASH_MAP_HPP_
+#define MAPPED_HASH_MAP_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_HASH_MAP_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "ics_exceptions.hpp"
+#include "hashing.hpp"
+#include "hashsnapshot.hpp"
+
+
+namespace ics {
+
+
+//MappedFile maps a whole file read-only into memory (with mmap where available; elsewhere it reads
+//  the file into one buffer). The mapping lasts as long as the MappedFile; it is movable, not copyable.
+class MappedFile {
+  public:
+    explicit MappedFile (const std::string& file_name);
+    ~MappedFile ();
+    MappedFile (MappedFile&& to_move);
+    MappedFile (const MappedFile& to_copy)              = delete;
+    MappedFile& operator = (const MappedFile& rhs)      = delete;
+
+    const unsigned char* data () const {return bytes;}
+    std::uint64_t        size () const {return length;}
+
+  private:
+    const unsigned char* bytes  = nullptr;
+    std::uint64_t        length = 0;
+};
+
+
+//MappedHashMap serves lookups straight from a snapshot written by HashMap::save (see hashsnapshot.hpp):
+//  opening one validates the header and the bin starts, but reads/copies no records, so even a huge
+//  map is ready at once (the OS pages records in as lookups touch them). It is read-only.
+//MappedHashSet is the same for snapshots written by HashSet::save.
+//thash/chash are specified as in HashMap, and must be the hash function the snapshot was saved with.
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a) = nullptr> class MappedHashMap {
+  public:
+    typedef MapRecord<KEY,T> Record;
+    static_assert(std::is_trivially_copyable<KEY>::value and std::is_trivially_copyable<T>::value,
+                  "MappedHashMap: KEY and T must be trivially copyable");
+
+    explicit MappedHashMap (const std::string& file_name, hash_t<KEY> (*chash)(const KEY& a) = nullptr);
+
+    bool     empty   () const;
+    std::size_t size () const;
+    bool     has_key (const KEY& key) const;
+    const T& operator [] (const KEY& key) const;   //Raises KeyError if key is not in the map
+    std::string str  () const; //supplies useful debugging information; contrast to operator <<
+
+    //The records, grouped by bin: for-each loops see each key (r.key) with its value (r.value)
+    const Record* begin () const {return records;}
+    const Record* end   () const {return records + count;}
+
+    template<class KEY2,class T2, hash_t<KEY2> (*hash2)(const KEY2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const MappedHashMap<KEY2,T2,hash2>& m);
+
+  private:
+    HashFunction<KEY,thash> hash;   //Hashing function used (from template or constructor)
+    MappedFile           file;
+    const std::uint64_t* starts  = nullptr;
+    const Record*        records = nullptr;
+    std::size_t          bins    = 1;
+    std::size_t          count   = 0;
+
+    const Record* find_key (const KEY& key) const;  //Returns key's record or nullptr
+};
+
+
+template<class T, hash_t<T> (*thash)(const T& a) = nullptr> class MappedHashSet {
+  public:
+    typedef SetRecord<T> Record;
+    static_assert(std::is_trivially_copyable<T>::value, "MappedHashSet: T must be trivially copyable");
+
+    explicit MappedHashSet (const std::string& file_name, hash_t<T> (*chash)(const T& a) = nullptr);
+
+    bool empty    () const;
+    std::size_t size () const;
+    bool contains (const T& element) const;
+
+    //The records, grouped by bin: for-each loops see each element (r.key)
+    const Record* begin () const {return records;}
+    const Record* end   () const {return records + count;}
+
+  private:
+    HashFunction<T,thash> hash;     //Hashing function used (from template or constructor)
+    MappedFile           file;
+    const std::uint64_t* starts  = nullptr;
+    const Record*        records = nullptr;
+    std::size_t          bins    = 1;
+    std::size_t          count   = 0;
+};
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//MappedFile definitions
+
+inline MappedFile::MappedFile (const std::string& file_name) {
+#ifdef MAPPED_HASH_MAP_MMAP
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw FileOpenError("MappedFile: cannot open " + file_name);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0){
+        ::close(fd);
+        throw FileOpenError("MappedFile: cannot stat " + file_name);
+    }
+    length = static_cast<std::uint64_t>(info.st_size);
+    if (length > 0){
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED){
+            ::close(fd);
+            throw FileOpenError("MappedFile: cannot map " + file_name);
+        }
+        bytes = static_cast<const unsigned char*>(mapped);
+    }
+    ::close(fd);   //The mapping stays valid
+#else
+    std::ifstream in(file_name, std::ios::binary);
+    if (!in){
+        throw FileOpenError("MappedFile: cannot open " + file_name);
+    }
+    in.seekg(0, std::ios::end);
+    length = static_cast<std::uint64_t>(in.tellg());
+    in.seekg(0);
+    unsigned char* buffer = new unsigned char[length > 0 ? length : 1];
+    if (!in.read(reinterpret_cast<char*>(buffer), length)){
+        delete[] buffer;
+        throw FileOpenError("MappedFile: cannot read " + file_name);
+    }
+    bytes = buffer;
+#endif
+}
+
+
+inline MappedFile::~MappedFile () {
+    if (bytes == nullptr){
+        return;
+    }
+#ifdef MAPPED_HASH_MAP_MMAP
+    ::munmap(const_cast<unsigned char*>(bytes), length);
+#else
+    delete[] bytes;
+#endif
+}
+
+
+inline MappedFile::MappedFile (MappedFile&& to_move)
+: bytes(to_move.bytes), length(to_move.length) {
+    to_move.bytes  = nullptr;
+    to_move.length = 0;
+}
+
+
+//Checks that file holds a snapshot of Record (and its bin starts); sets starts/records/bins/count
+template<class Record>
+void open_snapshot (const MappedFile& file, const std::string& file_name, SnapshotKind kind, std::uint32_t key_size,
+                    std::uint32_t value_size, const std::uint64_t*& starts, const Record*& records, std::size_t& bins, std::size_t& count) {
+    if (file.size() < sizeof(SnapshotHeader)){
+        throw FileOpenError("snapshot " + file_name + ": too short for a header");
+    }
+    const SnapshotHeader& h = *reinterpret_cast<const SnapshotHeader*>(file.data());
+    check_snapshot<Record>(h, file.size(), file_name, kind, key_size, value_size);
+
+    starts  = reinterpret_cast<const std::uint64_t*>(file.data() + h.starts_offset);
+    records = reinterpret_cast<const Record*>(file.data() + h.records_offset);
+    bins    = std::size_t(h.bins);
+    count   = std::size_t(h.count);
+
+    //Lookups trust starts, so check it once: nondecreasing, from 0 to count
+    if (starts[0] != 0 or starts[bins] != h.count){
+        throw FileOpenError("snapshot " + file_name + ": corrupt bin starts");
+    }
+    for (std::size_t b = 0; b < bins; b++){
+        if (starts[b] > starts[b + 1]){
+            throw FileOpenError("snapshot " + file_name + ": corrupt bin starts");
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//MappedHashMap class and related definitions
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+MappedHashMap<KEY,T,thash>::MappedHashMap(const std::string& file_name, hash_t<KEY> (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), file(file_name) {
+    if (hash == nullptr){
+        throw TemplateFunctionError("MappedHashMap::constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("MappedHashMap::constructor: both specified and different");
+    }
+    open_snapshot(file, file_name, SnapshotKind::map, sizeof(KEY), sizeof(T), starts, records, bins, count);
+    if (count > 0 and hash(records[0].key) != records[0].hashed){
+        throw FileOpenError("MappedHashMap: " + file_name + " was saved with a different hash function");
+    }
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+bool MappedHashMap<KEY,T,thash>::empty() const {
+    return count == 0;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::size_t MappedHashMap<KEY,T,thash>::size() const {
+    return count;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+bool MappedHashMap<KEY,T,thash>::has_key(const KEY& key) const {
+    return find_key(key) != nullptr;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+const T& MappedHashMap<KEY,T,thash>::operator [] (const KEY& key) const {
+    const Record* r = find_key(key);
+    if (r == nullptr){
+        std::ostringstream answer;
+        answer << "MappedHashMap::operator []: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return r -> value;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::string MappedHashMap<KEY,T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "MappedHashMap[";
+    for (std::size_t b = 0; b < bins; b++){
+        answer << std::endl << "  bin[" << b << "]: ";
+        for (std::uint64_t i = starts[b]; i < starts[b + 1]; i++){
+            answer << records[i].key << "->" << records[i].value << " ";
+        }
+    }
+    answer << "](count=" << count << ",bins=" << bins << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+std::ostream& operator << (std::ostream& outs, const MappedHashMap<KEY,T,thash>& m) {
+    outs << "map[";
+    for (std::size_t i = 0; i < m.count; i++){
+        outs << (i == 0 ? "" : ",") << m.records[i].key << "->" << m.records[i].value;
+    }
+    outs << "]";
+    return outs;
+}
+
+
+template<class KEY,class T, hash_t<KEY> (*thash)(const KEY& a)>
+auto MappedHashMap<KEY,T,thash>::find_key(const KEY& key) const -> const Record* {
+    hash_t<KEY> hashed = hash(key);
+    std::size_t b = hash_bin<true>(hashed, bins);
+    for (const Record* r = records + starts[b], *stop = records + starts[b + 1]; r != stop; r++){
+        if (r -> hashed == hashed and r -> key == key){
+            return r;
+        }
+    }
+    return nullptr;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//MappedHashSet class and related definitions
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+MappedHashSet<T,thash>::MappedHashSet(const std::string& file_name, hash_t<T> (*chash)(const T& element))
+:   hash(thash != nullptr ? thash : chash), file(file_name) {
+    if (hash == nullptr){
+        throw TemplateFunctionError("MappedHashSet::constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("MappedHashSet::constructor: both specified and different");
+    }
+    open_snapshot(file, file_name, SnapshotKind::set, sizeof(T), 0, starts, records, bins, count);
+    if (count > 0 and hash(records[0].key) != records[0].hashed){
+        throw FileOpenError("MappedHashSet: " + file_name + " was saved with a different hash function");
+    }
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+bool MappedHashSet<T,thash>::empty() const {
+    return count == 0;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+std::size_t MappedHashSet<T,thash>::size() const {
+    return count;
+}
+
+
+template<class T, hash_t<T> (*thash)(const T& a)>
+bool MappedHashSet<T,thash>::contains(const T& element) const {
+    hash_t<T> hashed = hash(element);
+    std::size_t b = hash_bin<true>(hashed, bins);
+    for (const Record* r = records + starts[b], *stop = records + starts[b + 1]; r != stop; r++){
+        if (r -> hashed == hashed and r -> key == element){
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+#endif /* MAPPED_HASH_MAP_HPP_ */
@@ -0,0 +1,295 @@
+#ifndef NODE_POOL_HPP_
+#define NODE_POOL_HPP_
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace ics {
+
+
+//NodePool<N> supplies the list nodes (N objects) for one linked data structure.
+//Nodes are carved out of contiguous blocks (each block twice as big as the previous one, up to
+//  MAX_BLOCK nodes), and recycled nodes go onto a free list that make reuses before touching a block.
+//release_all gives back every block at once without visiting the nodes: the owner must have
+//  already destroyed (recycled, or called destroy on) every live node whose type is not trivially
+//  destructible (see needs_destroy).
+//A pool is not copyable: a copied data structure allocates its own nodes from its own pool.
+//A pool is not thread-safe: threads building one structure in parallel each make nodes from their
+//  own pool, and the structure's pool then absorbs them.
+template<class N> class NodePool {
+  public:
+    static constexpr bool needs_destroy = !std::is_trivially_destructible<N>::value;
+
+    NodePool  () {}
+    ~NodePool ();
+    NodePool  (const NodePool<N>& to_copy)             = delete;
+    NodePool<N>& operator = (const NodePool<N>& rhs)   = delete;
+
+    template<class... Args>
+    N*   make        (Args&&... args);   //Construct a node (from the free list if possible)
+    void recycle     (N* n);             //Destroy n and put its memory on the free list
+    void destroy     (N* n);             //Destroy n without reusing its memory (before release_all)
+    void release_all ();                 //Free every block; all nodes become invalid
+    void swap        (NodePool<N>& other);
+    void absorb      (NodePool<N>& other);  //Take over other's blocks (and so its live nodes); other becomes empty
+
+  private:
+    static constexpr int MIN_BLOCK = 16;
+    static constexpr int MAX_BLOCK = 4096;
+
+    union Slot {
+      Slot* next_free;
+      alignas(N) unsigned char node[sizeof(N)];
+    };
+
+    //Nodes aligned more strictly than plain operator new guarantees (e.g., to cache lines) need aligned blocks
+    static constexpr bool over_aligned = alignof(Slot) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    static Slot* allocate_slots (int count);
+    static void  free_slots     (Slot* slots);
+
+    class Block {
+      public:
+        Block* next;
+        Slot*  slots;
+    };
+
+    Slot*  free_list  = nullptr;   //Recycled slots
+    Block* blocks     = nullptr;   //Most recently allocated block first
+    int    block_size = 0;         //# slots in blocks (the newest block)
+    int    unused     = 0;         //# slots at the end of the newest block never handed out
+};
+
+
+
+//InlineNodes<N,COUNT> holds up to COUNT nodes inside the object that owns it, so a small structure
+//  allocates no memory for its nodes: the owner tries make here first, and falls back to its NodePool
+//  when make returns nullptr.
+//These nodes belong to the owning object itself, not to a pool: before the owner hands its nodes to
+//  another object (e.g., by swapping pools) it must replace every node here by a pool node (see at).
+template<class N, int COUNT> class InlineNodes {
+  public:
+    static_assert(COUNT >= 1 and COUNT <= 32, "InlineNodes: COUNT must be in [1,32]");
+
+    InlineNodes  () {}
+    InlineNodes  (const InlineNodes<N,COUNT>& to_copy)                   = delete;
+    InlineNodes<N,COUNT>& operator = (const InlineNodes<N,COUNT>& rhs)   = delete;
+
+    template<class... Args>
+    N*   make       (Args&&... args);   //Construct a node in a free slot; nullptr if every slot is in use
+    bool owns       (const N* n) const; //Whether n is in one of these slots
+    void recycle    (N* n);             //Destroy n (which must be owned) and free its slot
+    void forget_all ()                  {used = 0;}    //Free every slot (the owner already destroyed their nodes)
+    bool empty      () const            {return used == 0;}
+    N*   at         (int i);            //The node in slot i (in [0,COUNT)), or nullptr if that slot is free
+
+  private:
+    union Slot {
+      alignas(N) unsigned char node[sizeof(N)];
+    };
+
+    std::uint32_t used = 0;   //Bit i is set when slots[i] holds a node
+    Slot slots[COUNT];
+};
+
+
+//# of N nodes an InlineNodes should hold to keep up to wanted entries: fewer for big nodes, so every
+//  object (including the large ones that soon outgrow their inline nodes) stays within INLINE_NODE_BYTES
+constexpr std::size_t INLINE_NODE_BYTES = 512;
+
+template<class N>
+constexpr int inline_node_count(int wanted) {
+    return int(std::max<std::size_t>(1, std::min<std::size_t>(std::size_t(wanted), INLINE_NODE_BYTES / sizeof(N))));
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//NodePool class definitions
+
+template<class N>
+NodePool<N>::~NodePool() {
+    release_all();
+}
+
+
+template<class N>
+template<class... Args>
+N* NodePool<N>::make(Args&&... args) {
+    Slot* s;
+    if (free_list != nullptr){
+        s = free_list;
+        free_list = free_list->next_free;
+    }
+    else{
+        if (unused == 0){
+            int new_size = (block_size == 0 ? MIN_BLOCK : (block_size < MAX_BLOCK ? block_size * 2 : MAX_BLOCK));
+            Block* b = new Block();
+            b->slots  = allocate_slots(new_size);
+            b->next   = blocks;
+            blocks     = b;
+            block_size = new_size;
+            unused     = new_size;
+        }
+        s = blocks->slots + (block_size - unused--);
+    }
+
+    try{
+        return ::new (static_cast<void*>(s->node)) N(std::forward<Args>(args)...);
+    }catch (...){
+        s->next_free = free_list;
+        free_list    = s;
+        throw;
+    }
+}
+
+
+template<class N>
+void NodePool<N>::recycle(N* n) {
+    n->~N();
+    Slot* s = reinterpret_cast<Slot*>(n);
+    s->next_free = free_list;
+    free_list    = s;
+}
+
+
+template<class N>
+void NodePool<N>::destroy(N* n) {
+    n->~N();
+}
+
+
+template<class N>
+void NodePool<N>::release_all() {
+    while (blocks != nullptr){
+        Block* to_delete = blocks;
+        blocks = blocks->next;
+        free_slots(to_delete->slots);
+        delete to_delete;
+    }
+    free_list  = nullptr;
+    block_size = 0;
+    unused     = 0;
+}
+
+
+template<class N>
+auto NodePool<N>::allocate_slots(int count) -> Slot* {
+    if constexpr (over_aligned)
+        return static_cast<Slot*>(::operator new(sizeof(Slot) * count, std::align_val_t(alignof(Slot))));
+    else
+        return static_cast<Slot*>(::operator new(sizeof(Slot) * count));
+}
+
+
+template<class N>
+void NodePool<N>::free_slots(Slot* slots) {
+    if constexpr (over_aligned)
+        ::operator delete(slots, std::align_val_t(alignof(Slot)));
+    else
+        ::operator delete(slots);
+}
+
+
+template<class N>
+void NodePool<N>::swap(NodePool<N>& other) {
+    std::swap(free_list,  other.free_list);
+    std::swap(blocks,     other.blocks);
+    std::swap(block_size, other.block_size);
+    std::swap(unused,     other.unused);
+}
+
+
+template<class N>
+void NodePool<N>::absorb(NodePool<N>& other) {
+    if (other.blocks == nullptr){
+        return;
+    }
+
+    //Put other's never-used slots on its free list, so its newest block needs no unused count
+    for (; other.unused > 0; other.unused--){
+        Slot* s = other.blocks->slots + (other.block_size - other.unused);
+        s->next_free    = other.free_list;
+        other.free_list = s;
+    }
+
+    if (other.free_list != nullptr){
+        Slot* tail = other.free_list;
+        while (tail->next_free != nullptr){
+            tail = tail->next_free;
+        }
+        tail->next_free = free_list;
+        free_list       = other.free_list;
+    }
+
+    //Link other's blocks in after this pool's newest block (whose unused slots make still hands out)
+    if (blocks == nullptr){
+        blocks     = other.blocks;
+        block_size = other.block_size;
+    }
+    else{
+        Block* tail = other.blocks;
+        while (tail->next != nullptr){
+            tail = tail->next;
+        }
+        tail->next   = blocks->next;
+        blocks->next = other.blocks;
+    }
+
+    other.free_list  = nullptr;
+    other.blocks     = nullptr;
+    other.block_size = 0;
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//InlineNodes class definitions
+
+template<class N, int COUNT>
+template<class... Args>
+N* InlineNodes<N,COUNT>::make(Args&&... args) {
+    if (used == (std::uint32_t(-1) >> (32 - COUNT))){
+        return nullptr;
+    }
+    int i = 0;
+    while (used & (std::uint32_t(1) << i)){
+        i++;
+    }
+    N* n = ::new (static_cast<void*>(slots[i].node)) N(std::forward<Args>(args)...);
+    used |= std::uint32_t(1) << i;
+    return n;
+}
+
+
+template<class N, int COUNT>
+bool InlineNodes<N,COUNT>::owns(const N* n) const {
+    const void* p = n;
+    return !std::less<const void*>()(p, slots) and std::less<const void*>()(p, slots + COUNT);
+}
+
+
+template<class N, int COUNT>
+void InlineNodes<N,COUNT>::recycle(N* n) {
+    n->~N();
+    used &= ~(std::uint32_t(1) << (reinterpret_cast<Slot*>(n) - slots));
+}
+
+
+template<class N, int COUNT>
+N* InlineNodes<N,COUNT>::at(int i) {
+    return (used & (std::uint32_t(1) << i)) ? reinterpret_cast<N*>(slots[i].node) : nullptr;
+}
+
+}
+
+#endif /* NODE_POOL_HPP_ */
@@ -0,0 +1,731 @@
+#ifndef OPEN_HASH_MAP_HPP_
+#define OPEN_HASH_MAP_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <initializer_list>
+#include "ics_exceptions.hpp"
+#include "pair.hpp"
+#include "hashing.hpp"
+
+
+namespace ics {
+
+
+#ifndef undefinedhashdefined
+#define undefinedhashdefined
+template<class T>
+hash_t<T> undefinedhash (const T& a) {return 0;}
+#endif /* undefinedhashdefined */
+
+//OpenHashMap has the same interface as HashMap, but stores its entries directly in one flat
+//  array of slots (open addressing with linear probing) instead of in a list of LN per bin.
+//A lookup touches consecutive slots (usually one cache line) and put allocates nothing unless
+//  the array must grow. Erased slots become tombstones (so iterators stay valid while erasing);
+//  tombstones are reclaimed whenever the array is rehashed.
+//Because every entry lives in the array, load_threshold must be < 1 (it defaults to 0.5);
+//  the array is also grown whenever it would otherwise have no empty slot left.
+//
+//Instantiate the templated class supplying thash(a): produces a hash value for a.
+//If thash is defaulted to undefinedhash in the template, then a constructor must supply chash.
+//If both thash and chash are supplied, then they must be the same (by ==) function.
+//If neither is supplied, or both are supplied but different, TemplateFunctionError is raised.
+//The (unique) non-undefinedhash value supplied by thash/chash is stored in the instance variable hash.
+template<class KEY,class T, int (*thash)(const KEY& a) = nullptr> class OpenHashMap {
+  public:
+    typedef ics::pair<KEY,T>   Entry;
+    typedef int (*hashfunc) (const KEY& a);
+
+    //Destructor/Constructors
+    ~OpenHashMap ();
+
+    OpenHashMap          (double the_load_threshold = 0.5, int (*chash)(const KEY& a) = nullptr);
+    explicit OpenHashMap (int initial_bins, double the_load_threshold = 0.5, int (*chash)(const KEY& k) = nullptr);
+    OpenHashMap          (const OpenHashMap<KEY,T,thash>& to_copy, double the_load_threshold = 0.5, int (*chash)(const KEY& a) = nullptr);
+    explicit OpenHashMap (const std::initializer_list<Entry>& il, double the_load_threshold = 0.5, int (*chash)(const KEY& a) = nullptr);
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    explicit OpenHashMap (const Iterable& i, double the_load_threshold = 0.5, int (*chash)(const KEY& a) = nullptr);
+
+
+    //Queries
+    bool empty      () const;
+    int  size       () const;
+    bool has_key    (const KEY& key) const;
+    bool has_value  (const T& value) const;
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+
+    //Commands
+    T    put   (const KEY& key, const T& value);
+    T    erase (const KEY& key);
+    void clear ();
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    int put_all(const Iterable& i);
+
+
+    //Operators
+
+    T&       operator [] (const KEY&);
+    const T& operator [] (const KEY&) const;
+    OpenHashMap<KEY,T,thash>& operator = (const OpenHashMap<KEY,T,thash>& rhs);
+    bool operator == (const OpenHashMap<KEY,T,thash>& rhs) const;
+    bool operator != (const OpenHashMap<KEY,T,thash>& rhs) const;
+
+    template<class KEY2,class T2, int (*hash2)(const KEY2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const OpenHashMap<KEY2,T2,hash2>& m);
+
+
+
+  public:
+    class Iterator {
+      public:
+        typedef int Cursor;
+
+        //Private constructor called in begin/end, which are friends of OpenHashMap<T>
+        ~Iterator();
+        Entry       erase();
+        std::string str  () const;
+        OpenHashMap<KEY,T,thash>::Iterator& operator ++ ();
+        OpenHashMap<KEY,T,thash>::Iterator  operator ++ (int);
+        bool operator == (const OpenHashMap<KEY,T,thash>::Iterator& rhs) const;
+        bool operator != (const OpenHashMap<KEY,T,thash>::Iterator& rhs) const;
+        Entry& operator *  () const;
+        Entry* operator -> () const;
+        friend std::ostream& operator << (std::ostream& outs, const OpenHashMap<KEY,T,thash>::Iterator& i) {
+          outs << i.str(); //Use the same meaning as the debugging .str() method
+          return outs;
+        }
+        friend Iterator OpenHashMap<KEY,T,thash>::begin () const;
+        friend Iterator OpenHashMap<KEY,T,thash>::end   () const;
+
+      private:
+        //Erasing only turns the slot into a tombstone, so current still indexes it after erase
+        Cursor                    current; //Slot index; stops if -1
+        OpenHashMap<KEY,T,thash>* ref_map;
+        int                       expected_mod_count;
+        bool                      can_erase = true;
+
+        //Helper methods
+        void advance_cursors();
+
+        //Called in friends begin/end
+        Iterator(OpenHashMap<KEY,T,thash>* iterate_over, bool from_begin);
+    };
+
+
+    Iterator begin () const;
+    Iterator end   () const;
+
+
+  private:
+    enum SlotState {EMPTY, OCCUPIED, DELETED};
+
+    class Slot {
+    public:
+      Slot ()              : state(EMPTY){}
+      Slot (const Slot& s) : value(s.value), state(s.state){}
+
+      Entry     value;
+      SlotState state;
+  };
+
+  HashFunction<KEY,thash> hash; //Hashing function used (from template or constructor)
+  Slot* map     = nullptr;    //Pointer to array of slots: an entry is stored in the first free slot at/after its bin
+  double load_threshold;      //(used+deleted)/bins <= load_threshold
+  int bins      = 1;          //# slots in array (should start >= 1 so hash_compress doesn't % 0)
+  int used      = 0;          //Cache for number of key->value pairs in the hash table
+  int deleted   = 0;          //# tombstones: they do not store an entry but still lengthen probes
+  int mod_count = 0;          //For sensing concurrent modification
+
+
+  //Helper methods
+  int   hash_compress        (const KEY& key)          const;  //hash function ranged to [0,bins-1]
+  int   find_key             (const KEY& key)          const;  //Returns index of key's slot or -1
+  int   find_free            (const KEY& key)          const;  //Returns index of slot to put (absent) key into
+  Slot* copy_hash_table      (Slot* ht, int bins)      const;  //Copy the slots in ht (keeping each entry at its index)
+
+  void  ensure_load_threshold(int new_occupied);               //Reallocate if (used+deleted)/bins > load_threshold
+  void  rehash               (int new_bins);                   //Reinsert every entry into a new array, dropping tombstones
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//OpenHashMap class and related definitions
+
+//Destructor/Constructors
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>::~OpenHashMap() {
+    delete[] map;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>::OpenHashMap(double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold){
+    if (hash == nullptr){
+        throw TemplateFunctionError("OpenHashMap::default constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("OpenHashMap::default constructor: both specified and different");
+    }
+    map = new Slot[bins];
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>::OpenHashMap(int initial_bins, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(initial_bins){
+    if (hash == nullptr){
+        throw TemplateFunctionError("OpenHashMap::length constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("OpenHashMap::length constructor: both specified and different");
+    }
+    if (bins <= 0){
+        bins = 1;
+    }
+    map = new Slot[bins];
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>::OpenHashMap(const OpenHashMap<KEY,T,thash>& to_copy, double the_load_threshold, int (*chash)(const KEY& a))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(to_copy.bins)
+{
+    if (hash == nullptr){
+        hash = to_copy.hash;
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("OpenHashMap::copy constructor: both specified and different");
+    }
+    if (hash == to_copy.hash){
+        used    = to_copy.used;
+        deleted = to_copy.deleted;
+        map     = copy_hash_table(to_copy.map, to_copy.bins);
+    }
+    else{
+        bins = std::max(1, int(to_copy.size() / load_threshold) + 1);
+        map  = new Slot[bins];
+        for (int i = 0; i < to_copy.bins; i++){
+            if (to_copy.map[i].state == OCCUPIED){
+                put(to_copy.map[i].value.first, to_copy.map[i].value.second);
+            }
+        }
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>::OpenHashMap(const std::initializer_list<Entry>& il, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(std::max(1, int(il.size() / the_load_threshold) + 1))
+{
+    if (hash == nullptr){
+        throw TemplateFunctionError("OpenHashMap::initializer_list constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("OpenHashMap::initializer_list constructor: both specified and different");
+    }
+    map = new Slot[bins];
+    for (const Entry& m_entry : il){
+        put(m_entry.first, m_entry.second);
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template <class Iterable>
+OpenHashMap<KEY,T,thash>::OpenHashMap(const Iterable& i, double the_load_threshold, int (*chash)(const KEY& k))
+:   hash(thash != nullptr ? thash : chash), load_threshold(the_load_threshold), bins(std::max(1, int(i.size() / the_load_threshold) + 1))
+{
+    if (hash == nullptr){
+        throw TemplateFunctionError("OpenHashMap::Iterable constructor: neither specified");
+    }
+    if (thash != nullptr and chash != nullptr and thash != chash){
+        throw TemplateFunctionError("OpenHashMap::Iterable constructor: both specified and different");
+    }
+    map = new Slot[bins];
+    for (const Entry& m_entry : i){
+        put(m_entry.first, m_entry.second);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Queries
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool OpenHashMap<KEY,T,thash>::empty() const {
+    return used == 0;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+int OpenHashMap<KEY,T,thash>::size() const {
+    return used;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool OpenHashMap<KEY,T,thash>::has_key (const KEY& key) const {
+    return find_key(key) != -1;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool OpenHashMap<KEY,T,thash>::has_value (const T& value) const {
+    for (int i = 0; i < bins; i++){
+        if (map[i].state == OCCUPIED and value == map[i].value.second){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string OpenHashMap<KEY,T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "OpenHashMap[";
+    for (int i = 0; i < bins; i++){
+        answer << std::endl << "  slot[" << i << "]: ";
+        if (map[i].state == OCCUPIED){
+            answer << map[i].value.first << "->" << map[i].value.second << " (bin " << hash_compress(map[i].value.first) << ")";
+        }
+        else{
+            answer << (map[i].state == EMPTY ? "empty" : "deleted");
+        }
+    }
+    answer << "](load_threshold=" << load_threshold << ",bins=" << bins << ",used=" << used
+           << ",deleted=" << deleted << ",mod_count=" << mod_count << ")";
+    return answer.str();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Commands
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T OpenHashMap<KEY,T,thash>::put(const KEY& key, const T& value) {
+    int index = find_key(key);
+    mod_count++;
+    if (index != -1){
+        T to_return = map[index].value.second;
+        map[index].value.second = value;
+        return to_return;
+    }
+
+    ensure_load_threshold(used + deleted + 1);
+    index = find_free(key);
+    if (map[index].state == DELETED){
+        deleted--;
+    }
+    map[index].value = Entry(key, value);
+    map[index].state = OCCUPIED;
+    used++;
+    return value;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T OpenHashMap<KEY,T,thash>::erase(const KEY& key) {
+    int index = find_key(key);
+    if (index == -1){
+        std::ostringstream answer;
+        answer << "OpenHashMap::erase: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+
+    T to_return = map[index].value.second;
+    map[index].value = Entry();      //Release the key/value now; the next put probing this slot reuses it
+    map[index].state = DELETED;
+    used--;
+    deleted++;
+    mod_count++;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void OpenHashMap<KEY,T,thash>::clear() {
+    for (int i = 0; i < bins; i++){
+        if (map[i].state != EMPTY){
+            map[i].value = Entry();
+            map[i].state = EMPTY;
+        }
+    }
+    used    = 0;
+    deleted = 0;
+    mod_count++;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+template<class Iterable>
+int OpenHashMap<KEY,T,thash>::put_all(const Iterable& i) {
+    int count = 0;
+    for (const Entry& m_entry : i){
+        count++;
+        put(m_entry.first, m_entry.second);
+    }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Operators
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+T& OpenHashMap<KEY,T,thash>::operator [] (const KEY& key) {
+    int index = find_key(key);
+    if (index != -1){
+        return map[index].value.second;
+    }
+
+    ensure_load_threshold(used + deleted + 1);
+    index = find_free(key);
+    if (map[index].state == DELETED){
+        deleted--;
+    }
+    map[index].value = Entry(key, T());
+    map[index].state = OCCUPIED;
+    used++;
+    mod_count++;
+    return map[index].value.second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+const T& OpenHashMap<KEY,T,thash>::operator [] (const KEY& key) const {
+    int index = find_key(key);
+    if (index == -1){
+        std::ostringstream answer;
+        answer << "OpenHashMap::operator []: key(" << key << ") not in Map";
+        throw KeyError(answer.str());
+    }
+    return map[index].value.second;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>& OpenHashMap<KEY,T,thash>::operator = (const OpenHashMap<KEY,T,thash>& rhs) {
+    if (this == &rhs){
+        return *this;
+    }
+    if (hash == rhs.hash){
+        delete[] map;
+        bins    = rhs.bins;
+        used    = rhs.used;
+        deleted = rhs.deleted;
+        map     = copy_hash_table(rhs.map, rhs.bins);
+    }
+    else{
+        clear();
+        for (int i = 0; i < rhs.bins; i++){
+            if (rhs.map[i].state == OCCUPIED){
+                put(rhs.map[i].value.first, rhs.map[i].value.second);
+            }
+        }
+    }
+    mod_count++;
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool OpenHashMap<KEY,T,thash>::operator == (const OpenHashMap<KEY,T,thash>& rhs) const {
+    if (this == &rhs){
+        return true;
+    }
+    if (used != rhs.size()){
+        return false;
+    }
+
+    for (int i = 0; i < bins; i++){
+        if (map[i].state == OCCUPIED){
+            int index = rhs.find_key(map[i].value.first);
+            if (index == -1 or map[i].value.second != rhs.map[index].value.second){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool OpenHashMap<KEY,T,thash>::operator != (const OpenHashMap<KEY,T,thash>& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::ostream& operator << (std::ostream& outs, const OpenHashMap<KEY,T,thash>& m) {
+    outs << "map[";
+    bool first = true;
+    for (int i = 0; i < m.bins; i++){
+        if (m.map[i].state == OpenHashMap<KEY,T,thash>::OCCUPIED){
+            outs << (first ? "" : ",") << m.map[i].value.first << "->" << m.map[i].value.second;
+            first = false;
+        }
+    }
+    outs << "]";
+    return outs;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator constructors
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto OpenHashMap<KEY,T,thash>::begin () const -> OpenHashMap<KEY,T,thash>::Iterator {
+    return Iterator(const_cast<OpenHashMap<KEY,T,thash>*>(this), true);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto OpenHashMap<KEY,T,thash>::end () const -> OpenHashMap<KEY,T,thash>::Iterator {
+    return Iterator(const_cast<OpenHashMap<KEY,T,thash>*>(this), false);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Private helper methods
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+int OpenHashMap<KEY,T,thash>::hash_compress (const KEY& key) const {
+    return hash_bin<false>(hash(key), bins);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+int OpenHashMap<KEY,T,thash>::find_key (const KEY& key) const {
+    //There is always at least one EMPTY slot (see ensure_load_threshold), so this loop terminates
+    for (int i = hash_compress(key); map[i].state != EMPTY; i = (i + 1 == bins ? 0 : i + 1)){
+        if (map[i].state == OCCUPIED and key == map[i].value.first){
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+int OpenHashMap<KEY,T,thash>::find_free (const KEY& key) const {
+    int i = hash_compress(key);
+    while (map[i].state == OCCUPIED){
+        i = (i + 1 == bins ? 0 : i + 1);
+    }
+    return i;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+typename OpenHashMap<KEY,T,thash>::Slot* OpenHashMap<KEY,T,thash>::copy_hash_table (Slot* ht, int bins) const {
+    Slot* to_return = new Slot[bins];
+    for (int i = 0; i < bins; i++){
+        if (ht[i].state == OCCUPIED){
+            to_return[i].value = ht[i].value;
+        }
+        to_return[i].state = ht[i].state;
+    }
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void OpenHashMap<KEY,T,thash>::ensure_load_threshold(int new_occupied) {
+    if (double(new_occupied) / double(bins) <= load_threshold and new_occupied < bins){
+        return;
+    }
+
+    //If mostly tombstones are filling the array, rehashing at the same size reclaims them
+    int new_bins = bins;
+    while (double(used + 1) / double(new_bins) > load_threshold / 2.0 or used + 1 >= new_bins){
+        new_bins *= 2;
+    }
+    rehash(new_bins);
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void OpenHashMap<KEY,T,thash>::rehash (int new_bins) {
+    Slot* old_map  = map;
+    int   old_bins = bins;
+
+    map     = new Slot[new_bins];
+    bins    = new_bins;
+    deleted = 0;
+    for (int i = 0; i < old_bins; i++){
+        if (old_map[i].state == OCCUPIED){
+            int index = find_free(old_map[i].value.first);
+            map[index].value = old_map[i].value;
+            map[index].state = OCCUPIED;
+        }
+    }
+    delete[] old_map;
+}
+
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator class definitions
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+void OpenHashMap<KEY,T,thash>::Iterator::advance_cursors(){
+    for (int i = current + 1; i < ref_map->bins; i++){
+        if (ref_map->map[i].state == OCCUPIED){
+            current = i;
+            return;
+        }
+    }
+    current = -1;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>::Iterator::Iterator(OpenHashMap<KEY,T,thash>* iterate_over, bool from_begin)
+        : current(-1), ref_map(iterate_over), expected_mod_count(ref_map->mod_count) {
+    if (from_begin){
+        advance_cursors();
+    }
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+OpenHashMap<KEY,T,thash>::Iterator::~Iterator()
+{}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto OpenHashMap<KEY,T,thash>::Iterator::erase() -> Entry {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("OpenHashMap::Iterator::erase");
+    }
+    if (!can_erase){
+        throw CannotEraseError("OpenHashMap::Iterator::erase Iterator cursor already erased");
+    }
+    if (current == -1){
+        throw CannotEraseError("OpenHashMap::Iterator::erase Iterator cursor beyond data structure");
+    }
+
+    can_erase = false;
+    Entry to_return = ref_map->map[current].value;
+    ref_map->erase(to_return.first);
+    expected_mod_count = ref_map->mod_count;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+std::string OpenHashMap<KEY,T,thash>::Iterator::str() const {
+    std::ostringstream answer;
+    answer << ref_map->str() << "(current=" << current << ",expected_mod_count=" << expected_mod_count << ",can_erase=" << can_erase << ")";
+    return answer.str();
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto OpenHashMap<KEY,T,thash>::Iterator::operator ++ () -> OpenHashMap<KEY,T,thash>::Iterator& {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("OpenHashMap::Iterator::operator ++");
+    }
+    if (current == -1){
+        return *this;
+    }
+    advance_cursors();
+    can_erase = true;
+    return *this;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+auto OpenHashMap<KEY,T,thash>::Iterator::operator ++ (int) -> OpenHashMap<KEY,T,thash>::Iterator {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("OpenHashMap::Iterator::operator ++(int)");
+    }
+    if (current == -1){
+        return *this;
+    }
+    Iterator to_return(*this);
+    advance_cursors();
+    can_erase = true;
+    return to_return;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool OpenHashMap<KEY,T,thash>::Iterator::operator == (const OpenHashMap<KEY,T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("OpenHashMap::Iterator::operator ==");
+    }
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("OpenHashMap::Iterator::operator ==");
+    }
+    if (ref_map != rhsASI->ref_map){
+        throw ComparingDifferentIteratorsError("OpenHashMap::Iterator::operator ==");
+    }
+    return this->current == rhsASI->current;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+bool OpenHashMap<KEY,T,thash>::Iterator::operator != (const OpenHashMap<KEY,T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0){
+        throw IteratorTypeError("OpenHashMap::Iterator::operator !=");
+    }
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("OpenHashMap::Iterator::operator !=");
+    }
+    if (ref_map != rhsASI->ref_map){
+        throw ComparingDifferentIteratorsError("OpenHashMap::Iterator::operator !=");
+    }
+    return this->current != rhsASI->current;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+pair<KEY,T>& OpenHashMap<KEY,T,thash>::Iterator::operator *() const {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("OpenHashMap::Iterator::operator *");
+    }
+    if (!can_erase or current == -1){
+        throw IteratorPositionIllegal("OpenHashMap::Iterator::operator * Iterator illegal: exhausted");
+    }
+    return ref_map->map[current].value;
+}
+
+
+template<class KEY,class T, int (*thash)(const KEY& a)>
+pair<KEY,T>* OpenHashMap<KEY,T,thash>::Iterator::operator ->() const {
+    if (expected_mod_count != ref_map->mod_count){
+        throw ConcurrentModificationError("OpenHashMap::Iterator::operator ->");
+    }
+    if (!can_erase or current == -1){
+        throw IteratorPositionIllegal("OpenHashMap::Iterator::operator -> Iterator illegal: exhausted");
+    }
+    return &(ref_map->map[current].value);
+}
+}
+#endif /* OPEN_HASH_MAP_HPP_ */
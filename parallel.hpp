@@ -0,0 +1,152 @@
+#ifndef PARALLEL_HPP_
+#define PARALLEL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace ics {
+
+
+//Helpers for the parallel bulk operations of HashMap/HashSet.
+//Every function/operator they call on the elements (hash, ==, copying) must be safe to call from
+//  several threads at once on different objects (as pure functions are).
+
+
+//Operations on fewer items than this (per extra thread) are done serially: starting threads costs more
+constexpr int parallel_min_per_worker = 1 << 14;
+
+
+//Returns the # of threads to use for items items: 1 (serial) up to std::thread::hardware_concurrency
+inline int parallel_workers(std::size_t items, std::size_t min_per_worker = parallel_min_per_worker) {
+    std::size_t hardware = std::thread::hardware_concurrency();
+    return int(std::max<std::size_t>(1, std::min(hardware, items / min_per_worker)));
+}
+
+
+//Calls body(worker, task) once for every task in [0,tasks); worker (in [0,workers)) identifies the
+//  thread running it, and is 0 for the calling thread. Each thread claims the next unclaimed task.
+//If any call throws, no more tasks are started; after all threads finish, the first exception is rethrown.
+template<class Body>
+void parallel_for(int workers, int tasks, Body body) {
+    std::atomic<int>   next_task{0};
+    std::exception_ptr error;
+    std::mutex         error_lock;
+
+    auto run = [&] (int worker) {
+        try{
+            for (int task = next_task++; task < tasks; task = next_task++){
+                body(worker, task);
+            }
+        }catch (...){
+            std::lock_guard<std::mutex> guard(error_lock);
+            if (error == nullptr){
+                error = std::current_exception();
+            }
+            next_task = tasks;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try{
+        for (int worker = 1; worker < workers; worker++){
+            threads.emplace_back(run, worker);
+        }
+    }catch (...){
+        //Could not start another thread: the ones already running (and this one) claim every task
+    }
+    run(0);
+    for (std::thread& t : threads){
+        t.join();
+    }
+
+    if (error != nullptr){
+        std::rethrow_exception(error);
+    }
+}
+
+
+//Splits [0,items) into consecutive ranges (a few per worker) and calls body(worker, begin, end) for each
+template<class Body>
+void parallel_ranges(int workers, std::size_t items, Body body) {
+    int         ranges = int(std::max<std::size_t>(1, std::min<std::size_t>(items, 4 * workers)));
+    std::size_t length = (items + ranges - 1) / ranges;
+    parallel_for(workers, ranges, [&] (int worker, int range) {
+        std::size_t begin = range * length;
+        body(worker, begin, std::min(items, begin + length));
+    });
+}
+
+
+//Sets order to the indexes [0,items) grouped by part_of(index) (which must be in [0,parts)): the
+//  indexes in part p are order[starts[p]..starts[p+1]-1], in increasing order (so a later duplicate
+//  is still processed after an earlier one). A two-pass (count, then scatter) radix partition.
+template<class PartOf>
+void parallel_partition(int workers, std::size_t items, int parts, PartOf part_of,
+                        std::vector<std::size_t>& order, std::vector<std::size_t>& starts) {
+    int         ranges = int(std::max<std::size_t>(1, std::min<std::size_t>(items, 4 * workers)));
+    std::size_t length = (items + ranges - 1) / ranges;
+
+    std::vector<int>         part(items);
+    std::vector<std::size_t> offset(std::size_t(ranges) * parts, 0);   //offset[r*parts+p]: # (then first index) of part p in range r
+    parallel_for(workers, ranges, [&] (int, int r) {
+        std::size_t* count = &offset[std::size_t(r) * parts];
+        for (std::size_t j = r * length, end = std::min(items, j + length); j < end; j++){
+            part[j] = part_of(j);
+            count[part[j]]++;
+        }
+    });
+
+    starts.assign(parts + 1, 0);
+    std::size_t total = 0;
+    for (int p = 0; p < parts; p++){
+        starts[p] = total;
+        for (int r = 0; r < ranges; r++){
+            std::size_t count = offset[std::size_t(r) * parts + p];
+            offset[std::size_t(r) * parts + p] = total;
+            total += count;
+        }
+    }
+    starts[parts] = total;
+
+    order.resize(items);
+    parallel_for(workers, ranges, [&] (int, int r) {
+        std::size_t* next = &offset[std::size_t(r) * parts];
+        for (std::size_t j = r * length, end = std::min(items, j + length); j < end; j++){
+            order[next[part[j]]++] = j;
+        }
+    });
+}
+
+
+//Collects pointers to the values i produces (in order) in items, so threads can index them.
+//If i's iterator does not produce references to E objects, the values are first copied into copies.
+template<class E, class Iterable>
+void gather(const Iterable& i, std::vector<const E*>& items, std::vector<E>& copies) {
+    typedef decltype(*std::begin(i)) Produced;
+    if constexpr (std::is_lvalue_reference<Produced>::value and std::is_same<typename std::decay<Produced>::type, E>::value){
+        for (const E& e : i){
+            items.push_back(&e);
+        }
+    }
+    else{
+        for (auto&& e : i){
+            copies.push_back(E(e));
+        }
+        items.reserve(copies.size());
+        for (const E& e : copies){
+            items.push_back(&e);
+        }
+    }
+}
+
+}
+
+#endif /* PARALLEL_HPP_ */
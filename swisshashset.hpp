@@ -0,0 +1,802 @@
+#ifndef SWISS_HASH_SET_HPP_
+#define SWISS_HASH_SET_HPP_
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <initializer_list>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWISS_HASH_SET_SSE2
+#endif
+#include "ics_exceptions.hpp"
+#include "pair.hpp"
+#include "hashing.hpp"
+
+
+namespace ics {
+
+
+#ifndef undefinedhashdefined
+#define undefinedhashdefined
+template<class T>
+hash_t<T> undefinedhash (const T& a) {return 0;}
+#endif /* undefinedhashdefined */
+
+//SwissHashSet has the same interface as HashSet, but uses a "Swiss table" layout: the elements are
+//  stored in a flat array of slots divided into groups of 16, and a parallel array of control bytes
+//  holds, for each slot, either EMPTY, DELETED, or the low 7 bits of the element's (mixed) hash.
+//contains compares the 7-bit fragment against all 16 control bytes of a group at once (one SSE2
+//  instruction; a portable loop when SSE2 is unavailable) and calls == only on fragment matches.
+//  A probe stops at the first group holding an EMPTY byte, so most misses test just one group.
+//load_threshold must be < 1 (it defaults to 0.875).
+//
+//Instantiate the templated class supplying thash(a): produces a hash value for a.
+//If thash is defaulted to undefinedhash in the template, then a constructor must supply chash.
+//If both thash and chash are supplied, then they must be the same (by ==) function.
+//If neither is supplied, or both are supplied but different, TemplateFunctionError is raised.
+//The (unique) non-undefinedhash value supplied by thash/chash is stored in the instance variable hash.
+template<class T, int (*thash)(const T& a) = undefinedhash<T>> class SwissHashSet {
+  public:
+    typedef int (*hashfunc) (const T& a);
+
+    //Destructor/Constructors
+    ~SwissHashSet ();
+
+    SwissHashSet (double the_load_threshold = 0.875, int (*chash)(const T& a) = nullptr);
+    explicit SwissHashSet (int initial_bins, double the_load_threshold = 0.875, int (*chash)(const T& k) = nullptr);
+    SwissHashSet (const SwissHashSet<T,thash>& to_copy, double the_load_threshold = 0.875, int (*chash)(const T& a) = nullptr);
+    explicit SwissHashSet (const std::initializer_list<T>& il, double the_load_threshold = 0.875, int (*chash)(const T& a) = nullptr);
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    explicit SwissHashSet (const Iterable& i, double the_load_threshold = 0.875, int (*chash)(const T& a) = nullptr);
+
+
+    //Queries
+    bool empty      () const;
+    int  size       () const;
+    bool contains   (const T& element) const;
+    std::string str () const; //supplies useful debugging information; contrast to operator <<
+
+    //Iterable class must support "for-each" loop: .begin()/.end() and prefix ++ on returned result
+    template <class Iterable>
+    bool contains_all (const Iterable& i) const;
+
+
+    //Commands
+    int  insert (const T& element);
+    int  erase  (const T& element);
+    void clear  ();
+
+    //Iterable class must support "for" loop: .begin()/.end() and prefix ++ on returned result
+
+    template <class Iterable>
+    int insert_all(const Iterable& i);
+
+    template <class Iterable>
+    int erase_all(const Iterable& i);
+
+    template<class Iterable>
+    int retain_all(const Iterable& i);
+
+
+    //Operators
+    SwissHashSet<T,thash>& operator = (const SwissHashSet<T,thash>& rhs);
+    bool operator == (const SwissHashSet<T,thash>& rhs) const;
+    bool operator != (const SwissHashSet<T,thash>& rhs) const;
+    bool operator <= (const SwissHashSet<T,thash>& rhs) const;
+    bool operator <  (const SwissHashSet<T,thash>& rhs) const;
+    bool operator >= (const SwissHashSet<T,thash>& rhs) const;
+    bool operator >  (const SwissHashSet<T,thash>& rhs) const;
+
+    template<class T2, int (*hash2)(const T2& a)>
+    friend std::ostream& operator << (std::ostream& outs, const SwissHashSet<T2,hash2>& s);
+
+
+
+  public:
+    class Iterator {
+      public:
+        typedef int Cursor;
+
+        //Private constructor called in begin/end, which are friends of SwissHashSet<T,thash>
+        ~Iterator();
+        T           erase();
+        std::string str  () const;
+        SwissHashSet<T,thash>::Iterator& operator ++ ();
+        SwissHashSet<T,thash>::Iterator  operator ++ (int);
+        bool operator == (const SwissHashSet<T,thash>::Iterator& rhs) const;
+        bool operator != (const SwissHashSet<T,thash>::Iterator& rhs) const;
+        T& operator *  () const;
+        T* operator -> () const;
+        friend std::ostream& operator << (std::ostream& outs, const SwissHashSet<T,thash>::Iterator& i) {
+          outs << i.str(); //Use the same meaning as the debugging .str() method
+          return outs;
+        }
+        friend Iterator SwissHashSet<T,thash>::begin () const;
+        friend Iterator SwissHashSet<T,thash>::end   () const;
+
+      private:
+        //Erasing only rewrites the slot's control byte, so current still indexes it after erase
+        Cursor                 current; //Slot index; stops if -1
+        SwissHashSet<T,thash>* ref_set;
+        int                    expected_mod_count;
+        bool                   can_erase = true;
+
+        //Helper methods
+        void advance_cursors();
+
+        //Called in friends begin/end
+        Iterator(SwissHashSet<T,thash>* iterate_over, bool from_begin);
+    };
+
+
+    Iterator begin () const;
+    Iterator end   () const;
+
+
+  private:
+    static constexpr int         GROUP_WIDTH = 16;
+    static constexpr signed char EMPTY       = -128;  //0b10000000
+    static constexpr signed char DELETED     = -2;    //0b11111110; full slots store 0b0xxxxxxx
+
+public:
+  HashFunction<T,thash> hash;  //Hashing function used (from template or constructor)
+private:
+  signed char* ctrl = nullptr; //Control byte for each slot: EMPTY, DELETED, or 7-bit hash fragment (full)
+  T* set            = nullptr; //Pointer to array of slots (only meaningful where the control byte is full)
+  double load_threshold;       //(used+deleted)/bins <= load_threshold
+  int groups    = 1;           //# groups of GROUP_WIDTH slots (always a power of 2)
+  int bins      = GROUP_WIDTH; //# slots in array == groups*GROUP_WIDTH
+  int used      = 0;           //Cache for number of values in the hash table
+  int deleted   = 0;           //# DELETED control bytes: they do not store a value but still lengthen probes
+  int mod_count = 0;           //For sensing concurrent modification
+
+
+  //Helper methods
+  static int   match_fragment     (const signed char* g, signed char fragment);  //Bit i set iff g[i] == fragment
+  static int   match_empty        (const signed char* g);           //Bit i set iff g[i] == EMPTY
+  static int   match_free         (const signed char* g);           //Bit i set iff g[i] is EMPTY or DELETED
+  static int   lowest_bit         (int mask);                       //Index of the lowest set bit in mask != 0
+
+  unsigned int hash_compress      (const T& element)          const;  //mixed hash: group from high bits, fragment from low 7
+  int   find_element              (const T& element)          const;  //Returns index of element's slot or -1
+  int   find_free                 (unsigned int h)            const;  //Returns index of slot to insert (absent) hash h into
+  void  allocate                  (int new_groups);                   //Allocate all-EMPTY arrays (does not free old ones)
+
+  void  ensure_load_threshold     (int new_occupied);                 //Reallocate if (used+deleted)/bins > load_threshold
+  void  rehash                    (int new_groups);                   //Reinsert every value into new arrays, dropping DELETED
+  void  erase_at                  (int index);                        //Remove the value stored in slot index
+};
+
+
+
+
+
+//SwissHashSet class and related definitions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Destructor/Constructors
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>::~SwissHashSet() {
+    delete[] ctrl;
+    delete[] set;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>::SwissHashSet(double the_load_threshold, int (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
+    if (hash == nullptr)
+        throw TemplateFunctionError("SwissHashSet::default constructor: neither specified");
+    if (thash != undefinedhash<T> && chash != nullptr && chash != thash)
+        throw TemplateFunctionError("SwissHashSet::default constructor: both specified and different");
+    allocate(1);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>::SwissHashSet(int initial_bins, double the_load_threshold, int (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
+    if (hash == nullptr)
+        throw TemplateFunctionError("SwissHashSet::length constructor: neither specified");
+    if (thash != undefinedhash<T> && chash != nullptr && chash != thash)
+        throw TemplateFunctionError("SwissHashSet::length constructor: both specified and different");
+    int g = 1;
+    while (g * GROUP_WIDTH < initial_bins)
+        g *= 2;
+    allocate(g);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>::SwissHashSet(const SwissHashSet<T,thash>& to_copy, double the_load_threshold, int (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
+    if (hash == nullptr)
+        hash = to_copy.hash;
+    if (thash != undefinedhash<T> && chash != nullptr && thash != chash)
+        throw TemplateFunctionError("SwissHashSet::copy constructor: both specified and different");
+    allocate(to_copy.groups);
+    if (hash == to_copy.hash) {
+        std::copy(to_copy.ctrl, to_copy.ctrl + bins, ctrl);
+        for (int i = 0; i < bins; ++i)
+            if (ctrl[i] >= 0)
+                set[i] = to_copy.set[i];
+        used    = to_copy.used;
+        deleted = to_copy.deleted;
+    } else
+        for (int i = 0; i < to_copy.bins; ++i)
+            if (to_copy.ctrl[i] >= 0)
+                insert(to_copy.set[i]);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>::SwissHashSet(const std::initializer_list<T>& il, double the_load_threshold, int (*chash)(const T& element))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
+    if (hash == nullptr)
+        throw TemplateFunctionError("SwissHashSet::initializer_list constructor: neither specified");
+    if (thash != undefinedhash<T> && chash != nullptr && thash != chash)
+        throw TemplateFunctionError("SwissHashSet::initializer_list constructor: both specified and different");
+    allocate(1);
+    ensure_load_threshold(int(il.size()));
+    for (const T& s_elem : il)
+        insert(s_elem);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class Iterable>
+SwissHashSet<T,thash>::SwissHashSet(const Iterable& i, double the_load_threshold, int (*chash)(const T& a))
+: hash(thash != undefinedhash<T> ? thash : chash), load_threshold(the_load_threshold) {
+    if (hash == nullptr)
+        throw TemplateFunctionError("SwissHashSet::Iterable constructor: neither specified");
+    if (thash != undefinedhash<T> && chash != nullptr && thash != chash)
+        throw TemplateFunctionError("SwissHashSet::Iterable constructor: both specified and different");
+    allocate(1);
+    ensure_load_threshold(int(i.size()));
+    for (const T& v : i)
+        insert(v);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Queries
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::empty() const {
+    return used == 0;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::size() const {
+    return used;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::contains (const T& element) const {
+    return find_element(element) != -1;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::string SwissHashSet<T,thash>::str() const {
+    std::ostringstream answer;
+    answer << "SwissHashSet[";
+    for (int g = 0; g < groups; ++g) {
+        answer << std::endl << "  group[" << g << "]:";
+        for (int i = g * GROUP_WIDTH; i < (g + 1) * GROUP_WIDTH; ++i)
+            if (ctrl[i] >= 0)
+                answer << " " << set[i] << "(" << int(ctrl[i]) << ")";
+            else if (ctrl[i] == DELETED)
+                answer << " #";
+    }
+    answer << "](load_threshold=" << load_threshold << ",bins=" << bins << ",used=" << used
+           << ",deleted=" << deleted << ",mod_count=" << mod_count << ")";
+    return answer.str();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template <class Iterable>
+bool SwissHashSet<T,thash>::contains_all(const Iterable& i) const {
+    for (const T& v : i)
+        if (!contains(v))
+            return false;
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Commands
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::insert(const T& element) {
+    if (find_element(element) != -1)
+        return 0;
+
+    ensure_load_threshold(used + deleted + 1);
+    unsigned int h = hash_compress(element);
+    int index = find_free(h);
+    if (ctrl[index] == DELETED)
+        --deleted;
+    ctrl[index] = static_cast<signed char>(h & 0x7F);
+    set[index]  = element;
+    ++used;
+    ++mod_count;
+    return 1;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::erase(const T& element) {
+    int index = find_element(element);
+    if (index == -1)
+        return 0;
+    erase_at(index);
+    return 1;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void SwissHashSet<T,thash>::clear() {
+    for (int i = 0; i < bins; ++i) {
+        if (ctrl[i] >= 0)
+            set[i] = T();
+        ctrl[i] = EMPTY;
+    }
+    used    = 0;
+    deleted = 0;
+    ++mod_count;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class Iterable>
+int SwissHashSet<T,thash>::insert_all(const Iterable& i) {
+    int count = 0;
+    for (const T& v : i)
+        count += insert(v);
+    return count;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class Iterable>
+int SwissHashSet<T,thash>::erase_all(const Iterable& i) {
+    int count = 0;
+    for (const T& v : i)
+        count += erase(v);
+    return count;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+template<class Iterable>
+int SwissHashSet<T,thash>::retain_all(const Iterable& i) {
+    SwissHashSet<T,thash> keep(i, load_threshold, hash);
+    int count = 0;
+    for (int b = 0; b < bins; ++b)
+        if (ctrl[b] >= 0 && !keep.contains(set[b])) {
+            erase_at(b);
+            ++count;
+        }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Operators
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>& SwissHashSet<T,thash>::operator = (const SwissHashSet<T,thash>& rhs) {
+    if (this == &rhs)
+        return *this;
+
+    if (hash == rhs.hash) {
+        delete[] ctrl;
+        delete[] set;
+        allocate(rhs.groups);
+        std::copy(rhs.ctrl, rhs.ctrl + bins, ctrl);
+        for (int i = 0; i < bins; ++i)
+            if (ctrl[i] >= 0)
+                set[i] = rhs.set[i];
+        used    = rhs.used;
+        deleted = rhs.deleted;
+    } else {
+        clear();
+        for (int i = 0; i < rhs.bins; ++i)
+            if (rhs.ctrl[i] >= 0)
+                insert(rhs.set[i]);
+    }
+    ++mod_count;
+    return *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::operator == (const SwissHashSet<T,thash>& rhs) const {
+    if (this == &rhs)
+        return true;
+    if (used != rhs.size())
+        return false;
+    return *this <= rhs;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::operator != (const SwissHashSet<T,thash>& rhs) const {
+    return !(*this == rhs);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::operator <= (const SwissHashSet<T,thash>& rhs) const {
+    if (this == &rhs)
+        return true;
+    if (used > rhs.size())
+        return false;
+    for (int i = 0; i < bins; ++i)
+        if (ctrl[i] >= 0 && !rhs.contains(set[i]))
+            return false;
+    return true;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::operator < (const SwissHashSet<T,thash>& rhs) const {
+    if (this == &rhs)
+        return false;
+    if (used >= rhs.size())
+        return false;
+    return *this <= rhs;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::operator >= (const SwissHashSet<T,thash>& rhs) const {
+    return rhs <= *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::operator > (const SwissHashSet<T,thash>& rhs) const {
+    return rhs < *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::ostream& operator << (std::ostream& outs, const SwissHashSet<T,thash>& s) {
+    outs << "set[";
+    bool first = true;
+    for (int i = 0; i < s.bins; ++i)
+        if (s.ctrl[i] >= 0) {
+            outs << (first ? "" : ",") << s.set[i];
+            first = false;
+        }
+    outs << "]";
+    return outs;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator constructors
+
+template<class T, int (*thash)(const T& a)>
+auto SwissHashSet<T,thash>::begin () const -> SwissHashSet<T,thash>::Iterator {
+    return Iterator(const_cast<SwissHashSet<T,thash>*>(this),true);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+auto SwissHashSet<T,thash>::end () const -> SwissHashSet<T,thash>::Iterator {
+    return Iterator(const_cast<SwissHashSet<T,thash>*>(this),false);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Private helper methods
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::match_fragment (const signed char* g, signed char fragment) {
+#ifdef SWISS_HASH_SET_SSE2
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(fragment)));
+#else
+    int mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; ++i)
+        if (g[i] == fragment)
+            mask |= 1 << i;
+    return mask;
+#endif
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::match_empty (const signed char* g) {
+    return match_fragment(g, EMPTY);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::match_free (const signed char* g) {
+#ifdef SWISS_HASH_SET_SSE2
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(g)));  //EMPTY/DELETED have the sign bit set
+#else
+    int mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; ++i)
+        if (g[i] < 0)
+            mask |= 1 << i;
+    return mask;
+#endif
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::lowest_bit (int mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(static_cast<unsigned int>(mask));
+#else
+    int i = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+
+template<class T, int (*thash)(const T& a)>
+unsigned int SwissHashSet<T,thash>::hash_compress (const T& element) const {
+    return hash_mix(hash(element));
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::find_element (const T& element) const {
+    unsigned int h        = hash_compress(element);
+    signed char  fragment = static_cast<signed char>(h & 0x7F);
+    //Triangular probing over a power-of-2 # of groups visits every group; there is always an EMPTY slot
+    for (int g = (h >> 7) & (groups - 1), step = 1; ; g = (g + step++) & (groups - 1)) {
+        const signed char* group = ctrl + g * GROUP_WIDTH;
+        for (int mask = match_fragment(group, fragment); mask != 0; mask &= mask - 1) {
+            int index = g * GROUP_WIDTH + lowest_bit(mask);
+            if (element == set[index])
+                return index;
+        }
+        if (match_empty(group) != 0)
+            return -1;
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+int SwissHashSet<T,thash>::find_free (unsigned int h) const {
+    for (int g = (h >> 7) & (groups - 1), step = 1; ; g = (g + step++) & (groups - 1)) {
+        int mask = match_free(ctrl + g * GROUP_WIDTH);
+        if (mask != 0)
+            return g * GROUP_WIDTH + lowest_bit(mask);
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void SwissHashSet<T,thash>::allocate (int new_groups) {
+    groups = new_groups;
+    bins   = new_groups * GROUP_WIDTH;
+    ctrl   = new signed char[bins];
+    set    = new T[bins];
+    std::fill(ctrl, ctrl + bins, EMPTY);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void SwissHashSet<T,thash>::ensure_load_threshold(int new_occupied) {
+    if (new_occupied <= load_threshold * bins && new_occupied < bins)
+        return;
+
+    //Size for the values that will be live: new_occupied also counts the DELETED bytes, which any
+    //  rehash drops (so constructors can presize for all their values at once)
+    int needed = std::max(used + 1, new_occupied - deleted);
+    int new_groups = groups;
+    while (needed > load_threshold * new_groups * GROUP_WIDTH / 2 || needed >= new_groups * GROUP_WIDTH)
+        new_groups *= 2;
+
+    //If mostly DELETED bytes are filling the array, rehashing at the same size reclaims them
+    if (new_groups == groups && deleted == 0)
+        return;
+    rehash(new_groups);
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void SwissHashSet<T,thash>::rehash (int new_groups) {
+    signed char* old_ctrl = ctrl;
+    T*           old_set  = set;
+    int          old_bins = bins;
+
+    allocate(new_groups);
+    deleted = 0;
+    for (int i = 0; i < old_bins; ++i)
+        if (old_ctrl[i] >= 0) {
+            int index = find_free(hash_compress(old_set[i]));
+            ctrl[index] = old_ctrl[i];
+            set[index]  = old_set[i];
+        }
+    delete[] old_ctrl;
+    delete[] old_set;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+void SwissHashSet<T,thash>::erase_at (int index) {
+    //A probe only continues past a group with no EMPTY slot; if this group still has one, no probe
+    //  ever passed through it, so the slot can become EMPTY instead of DELETED
+    if (match_empty(ctrl + index / GROUP_WIDTH * GROUP_WIDTH) != 0)
+        ctrl[index] = EMPTY;
+    else {
+        ctrl[index] = DELETED;
+        ++deleted;
+    }
+    set[index] = T();
+    --used;
+    ++mod_count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//Iterator class definitions
+
+template<class T, int (*thash)(const T& a)>
+void SwissHashSet<T,thash>::Iterator::advance_cursors() {
+    for (int i = current + 1; i < ref_set->bins; ++i)
+        if (ref_set->ctrl[i] >= 0) {
+            current = i;
+            return;
+        }
+    current = -1;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>::Iterator::Iterator(SwissHashSet<T,thash>* iterate_over, bool begin)
+: current(-1), ref_set(iterate_over) {
+    expected_mod_count = ref_set->mod_count;
+    if (begin) {
+        advance_cursors();
+    }
+}
+
+
+template<class T, int (*thash)(const T& a)>
+SwissHashSet<T,thash>::Iterator::~Iterator()
+{}
+
+
+template<class T, int (*thash)(const T& a)>
+T SwissHashSet<T,thash>::Iterator::erase() {
+    if (expected_mod_count != ref_set->mod_count) {
+        throw ConcurrentModificationError("SwissHashSet::Iterator::erase");
+    }
+    if (!can_erase) {
+        throw CannotEraseError("SwissHashSet::Iterator::erase Iterator cursor already erased");
+    }
+    if (current == -1) {
+        throw CannotEraseError("SwissHashSet::Iterator::erase Iterator cursor beyond data structure");
+    }
+    can_erase = false;
+    T to_return = ref_set->set[current];
+    ref_set->erase_at(current);
+    expected_mod_count = ref_set->mod_count;
+    return to_return;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+std::string SwissHashSet<T,thash>::Iterator::str() const {
+    std::ostringstream answer;
+    answer << ref_set->str() << "(current=" << current << ",expected_mod_count=" << expected_mod_count << ",can_erase=" << can_erase << ")";
+    return answer.str();
+}
+
+
+template<class T, int (*thash)(const T& a)>
+auto  SwissHashSet<T,thash>::Iterator::operator ++ () -> SwissHashSet<T,thash>::Iterator& {
+    if (expected_mod_count != ref_set->mod_count) {
+        throw ConcurrentModificationError("SwissHashSet::Iterator::operator ++");
+    }
+    if (current == -1) {
+        return *this;
+    }
+    advance_cursors();
+    can_erase = true;
+    return *this;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+auto  SwissHashSet<T,thash>::Iterator::operator ++ (int) -> SwissHashSet<T,thash>::Iterator {
+    if (expected_mod_count != ref_set->mod_count) {
+        throw ConcurrentModificationError("SwissHashSet::Iterator::operator ++(int)");
+    }
+    if (current == -1) {
+        return *this;
+    }
+    Iterator to_return(*this);
+    advance_cursors();
+    can_erase = true;
+    return to_return;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::Iterator::operator == (const SwissHashSet<T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0) {
+        throw IteratorTypeError("SwissHashSet::Iterator::operator ==");
+    }
+    if (expected_mod_count != ref_set->mod_count) {
+        throw ConcurrentModificationError("SwissHashSet::Iterator::operator ==");
+    }
+    if (ref_set != rhsASI->ref_set) {
+        throw ComparingDifferentIteratorsError("SwissHashSet::Iterator::operator ==");
+    }
+    return this->current == rhsASI->current;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+bool SwissHashSet<T,thash>::Iterator::operator != (const SwissHashSet<T,thash>::Iterator& rhs) const {
+    const Iterator* rhsASI = dynamic_cast<const Iterator*>(&rhs);
+    if (rhsASI == 0) {
+        throw IteratorTypeError("SwissHashSet::Iterator::operator !=");
+    }
+    if (expected_mod_count != ref_set->mod_count) {
+        throw ConcurrentModificationError("SwissHashSet::Iterator::operator !=");
+    }
+    if (ref_set != rhsASI->ref_set) {
+        throw ComparingDifferentIteratorsError("SwissHashSet::Iterator::operator !=");
+    }
+    return this->current != rhsASI->current;
+}
+
+
+template<class T, int (*thash)(const T& a)>
+T& SwissHashSet<T,thash>::Iterator::operator *() const {
+    if (expected_mod_count != ref_set->mod_count) {
+        throw ConcurrentModificationError("SwissHashSet::Iterator::operator *");
+    }
+    if (!can_erase || current == -1) {
+        throw IteratorPositionIllegal("SwissHashSet::Iterator::operator * Iterator illegal: exhausted");
+    }
+    return ref_set->set[current];
+}
+
+
+template<class T, int (*thash)(const T& a)>
+T* SwissHashSet<T,thash>::Iterator::operator ->() const {
+    if (expected_mod_count != ref_set->mod_count) {
+        throw ConcurrentModificationError("SwissHashSet::Iterator::operator ->");
+    }
+    if (!can_erase || current == -1) {
+        throw IteratorPositionIllegal("SwissHashSet::Iterator::operator -> Iterator illegal: exhausted");
+    }
+    return &(ref_set->set[current]);
+}
+
+}
+
+#endif /* SWISS_HASH_SET_HPP_ */